@@ -0,0 +1,129 @@
+/*
+ * [ Leon ]
+ *   Include/Leon/Core.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Leon's in-process API
+// Parses headers and runs Lua processes over them like Leon.CLI does, for tools that keep Leon loaded instead of running it per change.
+// Link Leon.Core to use it. Errors are thrown as std::runtime_error.
+
+namespace Leon
+{
+namespace Core
+{
+
+// Parse options
+struct ParseOptions
+{
+	// Include directories and defines, like -include and -define
+	std::vector<std::string> includes;
+	std::vector<std::string> defines;
+
+	// Models exported by other targets, like -import_model
+	std::vector<std::string> import_models;
+
+	// Parse what can be parsed without libclang, like the CLI does unless given -no_native
+	bool native = true;
+
+	// File contents by path, read instead of the files on disk, like -overlay
+	std::map<std::string, std::string> overlay;
+};
+
+// Reflection of a set of parsed headers
+class Reflection
+{
+	private:
+		friend class Session;
+		friend class Generator;
+
+		struct Data;
+		std::unique_ptr<Data> data;
+
+	public:
+		Reflection();
+		Reflection(Reflection &&other) noexcept;
+		Reflection &operator=(Reflection &&other) noexcept;
+		~Reflection();
+
+		// Paths of the parsed headers, in the order they were given
+		const std::vector<std::string> &GetSources() const;
+
+		// Save the model of every declaration reflected or referenced, in the format -export_model writes
+		// Returns whether the file was written, it's left untouched if it already holds the same model
+		bool SaveModel(const std::string &path) const;
+};
+
+// Generator output
+struct Output
+{
+	// SourceProcess results, one per source of the reflection
+	std::vector<std::string> sources;
+
+	// GlueProcess result
+	std::string glue;
+};
+
+// Lua process
+// Compiled once, and kept alive to run over any number of reflections
+class Generator
+{
+	private:
+		struct Data;
+		std::unique_ptr<Data> data;
+
+	public:
+		explicit Generator(const std::string &source);
+		Generator(Generator &&other) noexcept;
+		Generator &operator=(Generator &&other) noexcept;
+		~Generator();
+
+		// Run the process over a reflection
+		// GlueProcess is told each source's output is at the matching path of out_names, or an empty path if there's none
+		Output Run(const Reflection &reflection, const std::vector<std::string> &out_names = {});
+};
+
+// Parse session
+// Keeps libclang's index loaded between parses. Neither a session nor a generator can be used by two threads at once.
+class Session
+{
+	private:
+		struct Data;
+		std::unique_ptr<Data> data;
+
+	public:
+		Session();
+		Session(Session &&other) noexcept;
+		Session &operator=(Session &&other) noexcept;
+		~Session();
+
+		// Parse headers, each into its own translation unit
+		// Throws on the first header that fails to parse, with libclang's diagnostics in the message
+		Reflection Parse(const std::vector<std::string> &headers, const ParseOptions &options = {});
+};
+
+}
+}
@@ -35,3 +35,7 @@
 #define LEON_V(...)
 
 #endif
+
+// Marks a header to be parsed on its own, without reading its includes
+// Types it uses from elsewhere are reflected as opaque. Goes at the top of the header, before any annotation.
+#define LEON_SINGLE_FILE
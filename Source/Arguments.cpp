@@ -0,0 +1,75 @@
+/*
+ * [ Leon ]
+ *   Source/Arguments.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arguments.h"
+
+#include <cstring>
+
+namespace Leon
+{
+namespace Arguments
+{
+
+// libclang takes the list as an array of char pointers
+static_assert(sizeof(std::unique_ptr<char[]>) == sizeof(char *));
+
+void Push(std::vector<std::unique_ptr<char[]>> &args, const std::string &str)
+{
+	std::unique_ptr<char[]> data = std::make_unique<char[]>(str.size() + 1);
+	memcpy(data.get(), str.c_str(), str.size() + 1);
+	args.emplace_back(std::move(data));
+}
+
+std::vector<std::unique_ptr<char[]>> GetBase(const std::vector<std::string> &includes, const std::vector<std::string> &defines)
+{
+	std::vector<std::unique_ptr<char[]>> args;
+
+	Push(args, "-x"); Push(args, "c++");
+	Push(args, "-D_LEON_PROC");
+
+	// Include our system headers
+#define LEON_SYSTEM_INCLUDE_FRAME(header) Push(args, "-isystem"); Push(args, header);
+#include <LeonSystemIncludeFrame.h>
+#undef LEON_SYSTEM_INCLUDE_FRAME
+
+	// Include our provided headers
+	for (auto &i : includes)
+		Push(args, "-I" + i);
+
+	// Define our provided defines
+	for (auto &d : defines)
+		Push(args, "-D" + d);
+
+	return args;
+}
+
+void PushLanguage(std::vector<std::unique_ptr<char[]>> &args)
+{
+	Push(args, "-std=c++20");
+
+	Push(args, "-fhosted");
+	Push(args, "-fcxx-exceptions");
+	Push(args, "-fexceptions");
+}
+
+}
+}
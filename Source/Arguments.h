@@ -0,0 +1,45 @@
+/*
+ * [ Leon ]
+ *   Source/Arguments.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Leon
+{
+namespace Arguments
+{
+
+// Push a string onto a clang argument list
+void Push(std::vector<std::unique_ptr<char[]>> &args, const std::string &str);
+
+// Get the arguments every parse starts with
+// Parses as C++ with _LEON_PROC defined, our system headers, and the given include directories and defines.
+std::vector<std::unique_ptr<char[]>> GetBase(const std::vector<std::string> &includes, const std::vector<std::string> &defines);
+
+// Push the language flags for sources that don't have compile commands to provide their own
+void PushLanguage(std::vector<std::unique_ptr<char[]>> &args);
+
+}
+}
@@ -0,0 +1,593 @@
+/*
+ * [ Leon ]
+ *   Source/CompileCommands.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "CompileCommands.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace Leon
+{
+namespace CompileCommands
+{
+
+// Minimal JSON reader
+// Only strings are kept, which is all a compilation database has that we need
+struct JsonValue
+{
+	enum class Type
+	{
+		Null,
+		Boolean,
+		Number,
+		String,
+		Array,
+		Object,
+	} type = Type::Null;
+
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	const JsonValue *Get(const std::string &key) const
+	{
+		for (auto &i : object)
+			if (i.first == key)
+				return &i.second;
+		return nullptr;
+	}
+};
+
+class JsonReader
+{
+	private:
+		const std::string &src;
+		size_t i = 0;
+
+		[[noreturn]] void Error(const std::string &what)
+		{
+			throw std::runtime_error("Malformed compile commands at byte " + std::to_string(i) + ": " + what);
+		}
+
+		void SkipSpace()
+		{
+			while (i < src.size() && (src[i] == ' ' || src[i] == '\t' || src[i] == '\n' || src[i] == '\r'))
+				i++;
+		}
+
+		bool Consume(char c)
+		{
+			SkipSpace();
+			if (i < src.size() && src[i] == c)
+			{
+				i++;
+				return true;
+			}
+			return false;
+		}
+
+		void Expect(char c)
+		{
+			if (!Consume(c))
+				Error(std::string("expected `") + c + "`");
+		}
+
+		unsigned int ReadHex4()
+		{
+			if (i + 4 > src.size())
+				Error("truncated \\u escape");
+
+			unsigned int value = 0;
+			for (int d = 0; d < 4; d++)
+			{
+				char c = src[i++];
+				value <<= 4;
+				if (c >= '0' && c <= '9')
+					value |= c - '0';
+				else if (c >= 'a' && c <= 'f')
+					value |= c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F')
+					value |= c - 'A' + 10;
+				else
+					Error("invalid \\u escape");
+			}
+			return value;
+		}
+
+		std::string ReadString()
+		{
+			Expect('"');
+
+			std::string value;
+			while (1)
+			{
+				if (i >= src.size())
+					Error("unterminated string");
+
+				char c = src[i++];
+				if (c == '"')
+					break;
+				if (c != '\\')
+				{
+					value += c;
+					continue;
+				}
+
+				if (i >= src.size())
+					Error("unterminated string");
+
+				char e = src[i++];
+				switch (e)
+				{
+					case '"': value += '"'; break;
+					case '\\': value += '\\'; break;
+					case '/': value += '/'; break;
+					case 'b': value += '\b'; break;
+					case 'f': value += '\f'; break;
+					case 'n': value += '\n'; break;
+					case 'r': value += '\r'; break;
+					case 't': value += '\t'; break;
+					case 'u':
+					{
+						unsigned int cp = ReadHex4();
+
+						// Surrogate pair
+						if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < src.size() && src[i] == '\\' && src[i + 1] == 'u')
+						{
+							i += 2;
+							unsigned int low = ReadHex4();
+							cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+						}
+
+						// Encode as UTF-8
+						if (cp < 0x80)
+						{
+							value += static_cast<char>(cp);
+						}
+						else if (cp < 0x800)
+						{
+							value += static_cast<char>(0xC0 | (cp >> 6));
+							value += static_cast<char>(0x80 | (cp & 0x3F));
+						}
+						else if (cp < 0x10000)
+						{
+							value += static_cast<char>(0xE0 | (cp >> 12));
+							value += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+							value += static_cast<char>(0x80 | (cp & 0x3F));
+						}
+						else
+						{
+							value += static_cast<char>(0xF0 | (cp >> 18));
+							value += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+							value += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+							value += static_cast<char>(0x80 | (cp & 0x3F));
+						}
+						break;
+					}
+					default:
+						Error("invalid escape");
+				}
+			}
+
+			return value;
+		}
+
+	public:
+		JsonReader(const std::string &_src) : src(_src) {}
+
+		JsonValue ReadValue()
+		{
+			JsonValue value;
+
+			SkipSpace();
+			if (i >= src.size())
+				Error("unexpected end of file");
+
+			char c = src[i];
+			if (c == '"')
+			{
+				value.type = JsonValue::Type::String;
+				value.string = ReadString();
+			}
+			else if (c == '[')
+			{
+				i++;
+				value.type = JsonValue::Type::Array;
+				if (!Consume(']'))
+				{
+					do
+						value.array.push_back(ReadValue());
+					while (Consume(','));
+					Expect(']');
+				}
+			}
+			else if (c == '{')
+			{
+				i++;
+				value.type = JsonValue::Type::Object;
+				if (!Consume('}'))
+				{
+					do
+					{
+						SkipSpace();
+						std::string key = ReadString();
+						Expect(':');
+						value.object.emplace_back(std::move(key), ReadValue());
+					} while (Consume(','));
+					Expect('}');
+				}
+			}
+			else if (src.compare(i, 4, "true") == 0 || src.compare(i, 5, "false") == 0)
+			{
+				value.type = JsonValue::Type::Boolean;
+				i += (c == 't') ? 4 : 5;
+			}
+			else if (src.compare(i, 4, "null") == 0)
+			{
+				i += 4;
+			}
+			else if (c == '-' || (c >= '0' && c <= '9'))
+			{
+				value.type = JsonValue::Type::Number;
+				while (i < src.size() && (src[i] == '-' || src[i] == '+' || src[i] == '.' || src[i] == 'e' || src[i] == 'E' || (src[i] >= '0' && src[i] <= '9')))
+					value.string += src[i++];
+			}
+			else
+			{
+				Error("unexpected character");
+			}
+
+			return value;
+		}
+};
+
+// Split a shell command line into arguments
+static std::vector<std::string> SplitCommand(const std::string &command)
+{
+	std::vector<std::string> arguments;
+	std::string current;
+	bool has_current = false;
+	char quote = '\0';
+
+	for (size_t i = 0; i < command.size(); i++)
+	{
+		char c = command[i];
+
+		if (quote != '\0')
+		{
+			if (c == quote)
+				quote = '\0';
+			else if (c == '\\' && quote == '"' && i + 1 < command.size() && (command[i + 1] == '"' || command[i + 1] == '\\'))
+				current += command[++i];
+			else
+				current += c;
+		}
+		else if (c == '"' || c == '\'')
+		{
+			quote = c;
+			has_current = true;
+		}
+		else if (c == '\\' && i + 1 < command.size() && (command[i + 1] == '"' || command[i + 1] == '\'' || command[i + 1] == ' ' || command[i + 1] == '\\'))
+		{
+			// Backslashes only escape what the shell would treat specially, so Windows paths survive
+			current += command[++i];
+			has_current = true;
+		}
+		else if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+		{
+			if (has_current)
+				arguments.push_back(std::move(current));
+			current.clear();
+			has_current = false;
+		}
+		else
+		{
+			current += c;
+			has_current = true;
+		}
+	}
+
+	if (has_current)
+		arguments.push_back(std::move(current));
+
+	return arguments;
+}
+
+std::vector<Command> Load(const std::filesystem::path &path)
+{
+	std::stringstream sstream;
+	{
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream)
+			throw std::runtime_error("Failed to open compile commands: " + path.string());
+		sstream << stream.rdbuf();
+	}
+	std::string src = sstream.str();
+
+	JsonValue root = JsonReader(src).ReadValue();
+	if (root.type != JsonValue::Type::Array)
+		throw std::runtime_error("Compile commands aren't an array: " + path.string());
+
+	std::vector<Command> commands;
+	for (auto &entry : root.array)
+	{
+		const JsonValue *directory = entry.Get("directory");
+		const JsonValue *file = entry.Get("file");
+		if (directory == nullptr || file == nullptr)
+			continue;
+
+		Command command;
+		command.directory = std::filesystem::u8path(directory->string);
+		command.file = std::filesystem::u8path(file->string);
+		if (command.file.is_relative())
+			command.file = command.directory / command.file;
+		command.file = command.file.lexically_normal();
+
+		if (const JsonValue *arguments = entry.Get("arguments"))
+		{
+			for (auto &i : arguments->array)
+				command.arguments.push_back(i.string);
+		}
+		else if (const JsonValue *line = entry.Get("command"))
+		{
+			command.arguments = SplitCommand(line->string);
+		}
+
+		commands.emplace_back(std::move(command));
+	}
+
+	return commands;
+}
+
+std::vector<std::filesystem::path> LoadUnits(const std::filesystem::path &path)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+		throw std::runtime_error("Failed to open translation units: " + path.string());
+
+	std::string line;
+	std::getline(stream, line);
+	std::filesystem::path directory = std::filesystem::u8path(line);
+
+	std::vector<std::filesystem::path> units;
+	while (std::getline(stream, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty())
+			continue;
+
+		std::filesystem::path unit = std::filesystem::u8path(line);
+		if (unit.is_relative())
+			unit = directory / unit;
+		units.push_back(unit.lexically_normal());
+	}
+	return units;
+}
+
+const Command *Find(const std::vector<Command> &commands, const std::filesystem::path &source, const std::vector<std::filesystem::path> &units)
+{
+	std::filesystem::path source_path = std::filesystem::absolute(source).lexically_normal();
+	std::filesystem::path source_dir = source_path.parent_path();
+
+	// Only sharing the root says nothing about which project a file is from
+	std::filesystem::path root = source_path.root_path();
+	size_t root_common = std::distance(root.begin(), root.end());
+
+	const Command *best = nullptr;
+	size_t best_common = root_common;
+
+	for (auto &i : commands)
+	{
+		if (!units.empty() && std::find(units.begin(), units.end(), i.file) == units.end())
+			continue;
+
+		if (i.file == source_path)
+			return &i;
+
+		// Count the leading directories in common
+		size_t common = 0;
+		std::filesystem::path file_dir = i.file.parent_path();
+		for (auto a = source_dir.begin(), b = file_dir.begin(); a != source_dir.end() && b != file_dir.end() && *a == *b; ++a, ++b)
+			common++;
+
+		if (common > best_common)
+		{
+			best = &i;
+			best_common = common;
+		}
+	}
+
+	return best;
+}
+
+std::vector<std::string> GetParseFlags(const Command &command, bool keep_pch)
+{
+	std::vector<std::string> flags;
+
+	// Flags that take a path, either joined or as the next argument
+	static const char *path_flags[] = { "-I", "-isystem", "-iquote", "-idirafter", "-include", "-imacros", "-include-pch", "--sysroot=", "-isysroot" };
+
+	auto absolute = [&](const std::string &path) -> std::string
+		{
+			std::filesystem::path p = std::filesystem::u8path(path);
+			if (p.is_relative())
+				p = command.directory / p;
+
+			std::string result = p.lexically_normal().string();
+			for (auto &i : result)
+				if (i == '\\')
+					i = '/';
+			return result;
+		};
+
+	auto push_flag = [&](const std::string &flag, const std::string &value, bool joined)
+		{
+			if (flag == "-include-pch" && !keep_pch)
+				return;
+
+			bool is_path = false;
+			for (auto &p : path_flags)
+				if (flag == p)
+					is_path = true;
+
+			std::string arg = is_path ? absolute(value) : value;
+			if (joined)
+			{
+				flags.push_back(flag + arg);
+			}
+			else
+			{
+				flags.push_back(flag);
+				flags.push_back(arg);
+			}
+		};
+
+	// cl and clang-cl take MSVC style flags, starting with either / or -
+	bool msvc = false;
+	if (!command.arguments.empty())
+	{
+		std::string compiler = std::filesystem::u8path(command.arguments[0]).stem().string();
+		std::transform(compiler.begin(), compiler.end(), compiler.begin(), [](unsigned char c) { return std::tolower(c); });
+		msvc = compiler == "cl" || compiler == "clang-cl";
+	}
+
+	// Skip the compiler itself
+	for (size_t i = 1; i < command.arguments.size(); i++)
+	{
+		const std::string &arg = command.arguments[i];
+		bool has_next = i + 1 < command.arguments.size();
+
+		if (msvc && arg.size() > 1 && (arg[0] == '/' || arg[0] == '-') && arg != "-Xclang")
+		{
+			std::string name = arg.substr(1);
+
+			// Flags with a joined or separate value
+			auto value_flag = [&](const char *msvc_flag, const char *flag) -> bool
+				{
+					size_t length = strlen(msvc_flag);
+					if (name.compare(0, length, msvc_flag) != 0)
+						return false;
+
+					if (name.size() > length)
+						push_flag(flag, name.substr(length), false);
+					else if (has_next)
+						push_flag(flag, command.arguments[++i], false);
+					return true;
+				};
+
+			if (value_flag("external:I", "-isystem") || value_flag("FI", "-include") ||
+				value_flag("I", "-I") || value_flag("D", "-D") || value_flag("U", "-U"))
+				continue;
+
+			if (name.compare(0, 4, "std:") == 0)
+			{
+				std::string standard = name.substr(4);
+				if (standard == "c++latest")
+					standard = "c++2b";
+				flags.push_back("-std=" + standard);
+			}
+			else if (name == "EHsc" || name == "EHs" || name == "EHa")
+			{
+				flags.push_back("-fcxx-exceptions");
+				flags.push_back("-fexceptions");
+			}
+
+			// Anything else is codegen, outputs or MSVC's own precompiled headers, which libclang can't load
+			continue;
+		}
+
+		// Flags passed straight through to the frontend
+		// CMake's precompiled headers are passed this way
+		if (arg == "-Xclang" && has_next)
+		{
+			const std::string &xarg = command.arguments[++i];
+			if ((xarg == "-include" || xarg == "-include-pch") && i + 2 < command.arguments.size() && command.arguments[i + 1] == "-Xclang")
+			{
+				push_flag(xarg, command.arguments[i + 2], false);
+				i += 2;
+			}
+			continue;
+		}
+
+		// Flags with a separate value
+		bool separate = false;
+		for (auto &p : path_flags)
+		{
+			if (arg == p && has_next)
+			{
+				push_flag(arg, command.arguments[++i], false);
+				separate = true;
+				break;
+			}
+		}
+		if (separate)
+			continue;
+
+		if ((arg == "-D" || arg == "-U" || arg == "-target") && has_next)
+		{
+			flags.push_back(arg);
+			flags.push_back(command.arguments[++i]);
+			continue;
+		}
+
+		// Drop outputs and the inputs
+		if ((arg == "-o" || arg == "-MF" || arg == "-MT" || arg == "-MQ" || arg == "-x") && has_next)
+		{
+			i++;
+			continue;
+		}
+		if (arg.empty() || arg[0] != '-')
+			continue;
+		if (arg == "-c" || arg.compare(0, 2, "-M") == 0)
+			continue;
+
+		// Joined flags
+		if (arg.compare(0, 2, "-I") == 0)
+		{
+			push_flag("-I", arg.substr(2), true);
+			continue;
+		}
+		if (arg.compare(0, 10, "--sysroot=") == 0)
+		{
+			push_flag("--sysroot=", arg.substr(10), true);
+			continue;
+		}
+
+		// Keep anything else that changes how the source is parsed
+		if (arg.compare(0, 2, "-D") == 0 || arg.compare(0, 2, "-U") == 0 || arg.compare(0, 5, "-std=") == 0 ||
+			arg.compare(0, 2, "-f") == 0 || arg.compare(0, 2, "-m") == 0 || arg.compare(0, 9, "--target=") == 0 ||
+			arg.compare(0, 8, "-stdlib=") == 0 || arg.compare(0, 8, "-nostdinc") == 0 || arg == "-pthread")
+		{
+			flags.push_back(arg);
+		}
+	}
+
+	return flags;
+}
+
+}
+}
@@ -0,0 +1,64 @@
+/*
+ * [ Leon ]
+ *   Source/CompileCommands.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Leon
+{
+namespace CompileCommands
+{
+
+// Compilation database entry
+struct Command
+{
+	std::filesystem::path directory;
+	std::filesystem::path file;
+	std::vector<std::string> arguments;
+};
+
+// Load a compile_commands.json
+// Throws if the file can't be read or isn't a valid compilation database
+std::vector<Command> Load(const std::filesystem::path &path);
+
+// Load the translation units of a target, written by leon_target
+// The first line is the directory relative paths are relative to, then a path per line
+std::vector<std::filesystem::path> LoadUnits(const std::filesystem::path &path);
+
+// Find the command for a source
+// Sources that aren't compiled themselves, like headers, use the command of the file in the nearest directory.
+// Given units, only their commands are considered, so a source never takes another target's flags.
+// Returns nullptr if no command shares a directory below the root with the source.
+const Command *Find(const std::vector<Command> &commands, const std::filesystem::path &source, const std::vector<std::filesystem::path> &units = {});
+
+// Get the flags of a command that affect parsing
+// Include and define flags are kept, and relative paths are made absolute.
+// Outputs, dependency generation, and the compiler and its inputs are dropped.
+// MSVC style flags of cl and clang-cl are translated to the ones libclang takes.
+// Precompiled headers are only kept if keep_pch is set.
+std::vector<std::string> GetParseFlags(const Command &command, bool keep_pch);
+
+}
+}
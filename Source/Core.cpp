@@ -0,0 +1,207 @@
+/*
+ * [ Leon ]
+ *   Source/Core.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <Leon/Core.h>
+
+#include "Parse.h"
+#include "Native.h"
+#include "Model.h"
+#include "Overlay.h"
+#include "Process.h"
+#include "Arguments.h"
+
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+
+namespace Leon
+{
+namespace Core
+{
+
+// Reflection
+struct Reflection::Data
+{
+	std::vector<std::string> sources;
+
+	// Parse of each source, in the same order
+	std::vector<std::unique_ptr<Leon::Parse::Context>> contexts;
+
+	// Every source's declarations, merged
+	Leon::Model::Model model;
+};
+
+Reflection::Reflection() : data(std::make_unique<Data>()) {}
+Reflection::Reflection(Reflection &&other) noexcept = default;
+Reflection &Reflection::operator=(Reflection &&other) noexcept = default;
+Reflection::~Reflection() = default;
+
+const std::vector<std::string> &Reflection::GetSources() const
+{
+	return data->sources;
+}
+
+bool Reflection::SaveModel(const std::string &path) const
+{
+	return data->model.Save(path);
+}
+
+// Generator
+struct Generator::Data
+{
+	Leon::Process::Script script;
+
+	explicit Data(const std::string &source) : script(source) {}
+};
+
+Generator::Generator(const std::string &source) : data(std::make_unique<Data>(source)) {}
+Generator::Generator(Generator &&other) noexcept = default;
+Generator &Generator::operator=(Generator &&other) noexcept = default;
+Generator::~Generator() = default;
+
+Output Generator::Run(const Reflection &reflection, const std::vector<std::string> &out_names)
+{
+	auto &sources = reflection.data->sources;
+
+	Output output;
+	std::vector<Leon::Process::GlueSource> glue_sources;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		output.sources.push_back(data->script.SourceProcess(sources[i], *reflection.data->contexts[i]));
+		glue_sources.push_back({ sources[i], (i < out_names.size()) ? out_names[i] : std::string() });
+	}
+	output.glue = data->script.GlueProcess(glue_sources, reflection.data->model);
+
+	return output;
+}
+
+// Session
+struct Session::Data
+{
+	// Created once something is parsed with libclang
+	CXIndex index = nullptr;
+
+	~Data()
+	{
+		if (index != nullptr)
+			clang_disposeIndex(index);
+	}
+
+	CXIndex GetIndex()
+	{
+		if (index == nullptr)
+			index = clang_createIndex(0, 0);
+		return index;
+	}
+};
+
+Session::Session() : data(std::make_unique<Data>()) {}
+Session::Session(Session &&other) noexcept = default;
+Session &Session::operator=(Session &&other) noexcept = default;
+Session::~Session() = default;
+
+// Parse a header in libclang
+// Diagnostics become part of the error, as there's no console to report them to
+static void ParseHeader(CXIndex index, const std::string &path, const std::vector<std::unique_ptr<char[]>> &args, const Leon::Overlay::Overlay &overlay, Leon::Parse::Context &context)
+{
+	CXTranslationUnit tu;
+	CXErrorCode ec;
+
+	CXTranslationUnit_Flags flags = static_cast<CXTranslationUnit_Flags>(CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete);
+	ec = clang_parseTranslationUnit2(index, path.c_str(), reinterpret_cast<const char *const *>(args.data()), args.size(), overlay.GetUnsavedFiles(), overlay.GetNumUnsavedFiles(), flags, &tu);
+
+	std::ostringstream diagnostics;
+	try
+	{
+		Leon::Parse::CheckTranslationUnit(tu, ec, diagnostics);
+	}
+	catch (std::exception &e)
+	{
+		clang_disposeTranslationUnit(tu);
+		throw std::runtime_error(diagnostics.str() + e.what());
+	}
+
+	// The visitor throws on declarations it can't reflect, the translation unit still has to be disposed
+	try
+	{
+		clang_visitChildren(clang_getTranslationUnitCursor(tu), Leon::Parse::Visitor, &context);
+	}
+	catch (...)
+	{
+		clang_disposeTranslationUnit(tu);
+		throw;
+	}
+
+	clang_disposeTranslationUnit(tu);
+}
+
+Reflection Session::Parse(const std::vector<std::string> &headers, const ParseOptions &options)
+{
+	// Setup arguments, the same as Leon.CLI's without compile commands
+	std::vector<std::unique_ptr<char[]>> args = Leon::Arguments::GetBase(options.includes, options.defines);
+	Leon::Arguments::PushLanguage(args);
+
+	// Load the overlay and imported models
+	Leon::Overlay::Overlay overlay;
+	for (auto &i : options.overlay)
+		overlay.Set(Leon::Overlay::Overlay::GetPath(i.first), std::string(i.second));
+
+	Leon::Model::Model imports;
+	for (auto &i : options.import_models)
+	{
+		Leon::Model::Model model;
+		if (!model.Load(i))
+			throw std::runtime_error("Failed to load model: " + i);
+		imports.Merge(model);
+	}
+
+	// Parse each header
+	Reflection reflection;
+	for (auto &header : headers)
+	{
+		// Overlaid headers don't have to exist on disk
+		std::string path = Leon::Overlay::Overlay::GetPath(header);
+		bool overlaid = overlay.Find(path) != nullptr;
+		if (!overlaid && !std::filesystem::exists(path))
+			throw std::runtime_error("File \"" + header + "\" doesn't exist");
+
+		// The native frontend reads from disk, and leaves a partial context behind when it can't handle a header
+		auto context = std::make_unique<Leon::Parse::Context>();
+		if (!options.native || overlaid || !Leon::Native::ParseSource(path, *context, &imports))
+		{
+			context = std::make_unique<Leon::Parse::Context>();
+			ParseHeader(data->GetIndex(), path, args, overlay, *context);
+		}
+
+		Leon::Model::Model model;
+		model.Add(*context);
+		reflection.data->model.Merge(model, path);
+
+		reflection.data->sources.push_back(path);
+		reflection.data->contexts.push_back(std::move(context));
+	}
+
+	return reflection;
+}
+
+}
+}
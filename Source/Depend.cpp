@@ -0,0 +1,187 @@
+/*
+ * [ Leon ]
+ *   Source/Depend.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Depend.h"
+
+#include "Parse.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace Leon
+{
+namespace Depend
+{
+
+// Inclusions
+std::vector<std::string> GetInclusions(CXTranslationUnit tu)
+{
+	std::vector<std::string> inclusions;
+
+	auto visitor = [](CXFile included_file, CXSourceLocation *, unsigned, CXClientData client_data) -> void
+		{
+			auto &inclusions = *(reinterpret_cast<std::vector<std::string> *>(client_data));
+
+			std::string name = Leon::Parse::GetCXString(clang_getFileName(included_file));
+			if (!name.empty())
+				inclusions.push_back(name);
+		};
+
+	clang_getInclusions(tu, visitor, &inclusions);
+
+	return inclusions;
+}
+
+std::vector<Inclusion> GetMainInclusions(CXTranslationUnit tu)
+{
+	std::vector<Inclusion> inclusions;
+
+	auto visitor = [](CXFile included_file, CXSourceLocation *inclusion_stack, unsigned include_len, CXClientData client_data) -> void
+		{
+			auto &inclusions = *(reinterpret_cast<std::vector<Inclusion> *>(client_data));
+
+			Inclusion inclusion;
+			inclusion.name = Leon::Parse::GetCXString(clang_getFileName(included_file));
+			if (inclusion.name.empty())
+				return;
+
+			// The last location on the stack is the include directive in the main file
+			if (include_len != 0)
+				clang_getSpellingLocation(inclusion_stack[include_len - 1], nullptr, &inclusion.line, nullptr, nullptr);
+
+			inclusions.emplace_back(std::move(inclusion));
+		};
+
+	clang_getInclusions(tu, visitor, &inclusions);
+
+	return inclusions;
+}
+
+// Escape a path for a depfile
+static std::string EscapePath(const std::string &path)
+{
+	std::string out;
+	for (auto c : path)
+	{
+		if (c == '\\')
+			out += '/';
+		else if (c == ' ' || c == '#')
+			out += std::string("\\") + c;
+		else if (c == '$')
+			out += "$$";
+		else
+			out += c;
+	}
+	return out;
+}
+
+// Depfiles
+void WriteDepfile(const std::filesystem::path &path, const std::vector<std::string> &targets, const std::vector<std::string> &dependencies)
+{
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream)
+		throw std::runtime_error("Failed to open depfile: " + path.string());
+
+	for (size_t i = 0; i < targets.size(); i++)
+	{
+		if (i)
+			stream << " \\\n ";
+		stream << EscapePath(targets[i]);
+	}
+	stream << ':';
+
+	for (auto &i : dependencies)
+		stream << " \\\n " << EscapePath(i);
+	stream << '\n';
+}
+
+bool ReadDepfile(const std::filesystem::path &path, std::vector<std::string> &dependencies)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+		return false;
+
+	std::stringstream sstream;
+	sstream << stream.rdbuf();
+	std::string src = sstream.str();
+
+	// Split into unescaped paths, skipping the targets before the first colon
+	bool in_targets = true;
+	std::string token;
+
+	auto push_token = [&]() -> void
+		{
+			if (token.empty())
+				return;
+			if (in_targets && token.back() == ':')
+			{
+				// Drive letters are followed by a colon too, so only a trailing one ends the targets
+				in_targets = false;
+			}
+			else if (!in_targets)
+			{
+				dependencies.push_back(token);
+			}
+			token.clear();
+		};
+
+	for (size_t i = 0; i < src.size(); i++)
+	{
+		char c = src[i];
+		if (c == '\\' && i + 1 < src.size())
+		{
+			char e = src[i + 1];
+			if (e == ' ' || e == '#' || e == '\\')
+			{
+				token += e;
+				i++;
+				continue;
+			}
+			if (e == '\n' || e == '\r')
+			{
+				push_token();
+				continue;
+			}
+			token += c;
+		}
+		else if (c == '$' && i + 1 < src.size() && src[i + 1] == '$')
+		{
+			token += '$';
+			i++;
+		}
+		else if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+		{
+			push_token();
+		}
+		else
+		{
+			token += c;
+		}
+	}
+	push_token();
+
+	return true;
+}
+
+}
+}
@@ -0,0 +1,56 @@
+/*
+ * [ Leon ]
+ *   Source/Depend.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <clang-c/Index.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Leon
+{
+namespace Depend
+{
+
+// Get every file a translation unit includes, including the main file
+std::vector<std::string> GetInclusions(CXTranslationUnit tu);
+
+// Inclusion of a file, with the line of the main file it was first reached from
+struct Inclusion
+{
+	std::string name;
+	unsigned int line = 0; // 0 for the main file itself
+};
+
+std::vector<Inclusion> GetMainInclusions(CXTranslationUnit tu);
+
+// Write a Makefile style depfile
+void WriteDepfile(const std::filesystem::path &path, const std::vector<std::string> &targets, const std::vector<std::string> &dependencies);
+
+// Read the dependencies listed in a depfile
+// Returns false if the depfile doesn't exist
+bool ReadDepfile(const std::filesystem::path &path, std::vector<std::string> &dependencies);
+
+}
+}
@@ -21,13 +21,28 @@
 */
 
 #include "Parse.h"
+#include "Native.h"
+#include "Model.h"
 #include "Process.h"
+#include "Depend.h"
+#include "CompileCommands.h"
+#include "Manifest.h"
+#include "Prescan.h"
+#include "Overlay.h"
+#include "Arguments.h"
 
 #include <sstream>
 #include <fstream>
 #include <filesystem>
 #include <cstring>
 #include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <chrono>
 
 // Get standardized path
 struct StdPath
@@ -55,6 +70,31 @@ static StdPath GetStdPath(const std::string &src)
 	return out;
 }
 
+// Get standardized path of a file that may only exist in the overlay
+static StdPath GetStdPath(const std::string &src, const Leon::Overlay::Overlay &overlay)
+{
+	std::string utf8 = Leon::Overlay::Overlay::GetPath(src);
+	if (overlay.Find(utf8) == nullptr)
+		return GetStdPath(src);
+
+	StdPath out;
+	out.path = std::filesystem::path(utf8);
+	out.utf8 = utf8;
+	return out;
+}
+
+// Read overlay records from a stream into the overlay and manifest
+static void ReadOverlay(std::istream &stream, Leon::Overlay::Overlay &overlay, Leon::Manifest::Manifest &manifest)
+{
+	std::string path, contents;
+	while (Leon::Overlay::Overlay::ReadRecord(stream, path, contents))
+	{
+		path = Leon::Overlay::Overlay::GetPath(path);
+		manifest.Override(path, contents);
+		overlay.Set(path, std::move(contents));
+	}
+}
+
 // Parse a CMake list
 static std::vector<std::string> ParseCMakeList(const std::string &src)
 {
@@ -85,433 +125,1996 @@ static void CleanPath(std::filesystem::path &path)
 	}
 }
 
-// Entry point
-int main(int argc, char **argv)
+// Scan the include directives at the start of a source
+// Stops at the first line that isn't an include, a comment, or `#pragma once`.
+// Only <> includes are collected, as "" includes resolve relative to the including file.
+static std::vector<std::string> ScanIncludePrefix(const std::filesystem::path &path)
 {
-	try
+	std::vector<std::string> includes;
+
+	std::ifstream stream(path);
+	std::string line;
+	bool in_comment = false;
+
+	while (std::getline(stream, line))
 	{
-		// Print Leon information
-		std::cout << "========================================" << '\n';
-		std::cout << "Leon (" LEON_VERSION ")" << '\n';
-		std::cout << "libclang: " << Leon::Parse::GetCXString(clang_getClangVersion()) << '\n';
-		std::cout << "========================================" << std::endl;
+		// Strip comments
+		std::string code;
+		for (size_t i = 0; i < line.size(); i++)
+		{
+			if (in_comment)
+			{
+				if (line.compare(i, 2, "*/") == 0)
+				{
+					in_comment = false;
+					i++;
+				}
+			}
+			else if (line.compare(i, 2, "/*") == 0)
+			{
+				in_comment = true;
+				i++;
+			}
+			else if (line.compare(i, 2, "//") == 0)
+			{
+				break;
+			}
+			else
+			{
+				code += line[i];
+			}
+		}
+
+		// Read directive
+		std::stringstream code_stream(code);
+		std::string token;
+		if (!(code_stream >> token))
+			continue;
+
+		if (token == "#")
+		{
+			std::string directive;
+			code_stream >> directive;
+			token += directive;
+		}
+
+		if (token == "#pragma")
+		{
+			std::string pragma;
+			code_stream >> pragma;
+			if (pragma != "once")
+				break;
+		}
+		else if (token == "#include")
+		{
+			std::string include;
+			code_stream >> include;
+			if (include.size() < 2 || include.front() != '<' || include.back() != '>')
+				break;
+			includes.push_back(include);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	return includes;
+}
 
-		if (argc < 4)
+// Build a precompiled header out of the given includes
+// Returns false if the header couldn't be built, in which case sources should be parsed without it
+// Every file the header included is given to inclusions, if any, even when it couldn't be built
+static bool BuildPrecompiledHeader(const std::filesystem::path &pch_name, const std::vector<std::string> &includes, const std::vector<std::unique_ptr<char[]>> &args, const Leon::Overlay::Overlay &overlay, std::vector<std::string> *inclusions = nullptr)
+{
+	// Write the header to precompile
+	std::filesystem::path header_name = pch_name;
+	header_name.replace_extension(".h");
+	{
+		std::ofstream header_stream(header_name, std::ios::binary);
+		if (!header_stream)
+			return false;
+
+		for (auto &i : includes)
+			header_stream << "#include " << i << '\n';
+	}
+
+	// Parse the header for serialization
+	CXIndex index = clang_createIndex(0, 0);
+	CXTranslationUnit tu;
+
+	CXTranslationUnit_Flags flags = static_cast<CXTranslationUnit_Flags>(CXTranslationUnit_ForSerialization | CXTranslationUnit_Incomplete);
+	CXErrorCode ec = clang_parseTranslationUnit2(index, header_name.string().c_str(), reinterpret_cast<const char *const *>(args.data()), args.size(), overlay.GetUnsavedFiles(), overlay.GetNumUnsavedFiles(), flags, &tu);
+
+	bool result = ec == CXError_Success;
+
+	if (result)
+	{
+		if (inclusions != nullptr)
+			*inclusions = Leon::Depend::GetInclusions(tu);
+
+		// Don't save a broken header, the sources will report the errors themselves
+		size_t num_diagnostics = clang_getNumDiagnostics(tu);
+		for (unsigned int i = 0; i < num_diagnostics; i++)
 		{
-			std::cout << "Usage: " << argv[0] << " <binary_dir> <process.lua> [options] <source>" << std::endl;
-			return -1;
+			auto diagnostic = clang_getDiagnostic(tu, i);
+			auto severity = clang_getDiagnosticSeverity(diagnostic);
+			if (severity == CXDiagnostic_Error || severity == CXDiagnostic_Fatal)
+				result = false;
+			clang_disposeDiagnostic(diagnostic);
 		}
 
-		int argi = 1;
+		if (result)
+			result = clang_saveTranslationUnit(tu, pch_name.string().c_str(), clang_defaultSaveOptions(tu)) == CXSaveError_None;
 
-		std::filesystem::path binary_dir = std::filesystem::path(std::string(argv[argi++]));
-		StdPath lua_std = GetStdPath(argv[argi++]);
+		clang_disposeTranslationUnit(tu);
+	}
 
-		std::vector<std::string> in_includes;
-		std::vector<std::string> in_defines;
+	clang_disposeIndex(index);
+	return result;
+}
 
-		std::vector<StdPath> source_std;
+// Check if a precompiled header built elsewhere can be loaded by our libclang
+static bool IsPrecompiledHeaderUsable(const std::filesystem::path &pch_name)
+{
+	CXIndex index = clang_createIndex(0, 0);
+	CXTranslationUnit tu = nullptr;
 
-		// Create project directory
-		std::filesystem::create_directories(binary_dir);
-		
-		// Parse options
-		std::string out_extension, glue_extension;
+	bool result = clang_createTranslationUnit2(index, pch_name.string().c_str(), &tu) == CXError_Success;
 
-		std::string current_option;
+	clang_disposeTranslationUnit(tu);
+	clang_disposeIndex(index);
+	return result;
+}
 
-		for (; argi < argc; argi++)
+// Drop the precompiled headers from compile commands our libclang can't load
+// The arguments are hashed before this, so an up to date check never has to load libclang
+static void DropUnusablePrecompiledHeaders(std::vector<std::unique_ptr<char[]>> &args, std::unordered_map<std::string, bool> &usable_pchs)
+{
+	std::vector<std::unique_ptr<char[]>> kept;
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		if (strcmp(args[i].get(), "-include-pch") == 0 && i + 1 < args.size())
 		{
-			std::string args(argv[argi]);
+			std::string pch_name = args[i + 1].get();
 
-			if (current_option.empty())
+			auto usable = usable_pchs.find(pch_name);
+			if (usable == usable_pchs.end())
 			{
-				if (args == "-include")
-					current_option = args;
-				else if (args == "-define")
-					current_option = args;
-				else if (args == "-out_extension")
-					current_option = args;
-				else if (args == "-glue_extension")
-					current_option = args;
-				else
-					break;
+				usable = usable_pchs.emplace(pch_name, IsPrecompiledHeaderUsable(std::filesystem::u8path(pch_name))).first;
+				if (!usable->second)
+					std::cout << "[ Can't reuse `" << pch_name << "`, parsing without it ]" << '\n';
 			}
-			else
+
+			if (!usable->second)
 			{
-				if (current_option == "-include")
-				{
-					// Parse includes
-					auto arg_includes = ParseCMakeList(args);
-					in_includes.insert(in_includes.end(), arg_includes.begin(), arg_includes.end());
-				}
-				else if (current_option == "-define")
-				{
-					// Parse defines
-					auto arg_defines = ParseCMakeList(args);
-					in_defines.insert(in_defines.end(), arg_defines.begin(), arg_defines.end());
-				}
-				else if (current_option == "-out_extension")
-				{
-					out_extension = args;
-				}
-				else if (current_option == "-glue_extension")
-				{
-					glue_extension = args;
-				}
-				current_option.clear();
+				i++;
+				continue;
 			}
 		}
+		kept.emplace_back(std::move(args[i]));
+	}
+	args = std::move(kept);
+}
+
+// Print the version of libclang, once it's actually going to be used
+static void PrintClangVersion()
+{
+	static bool printed = false;
+	if (printed)
+		return;
+	printed = true;
+
+	std::cout << "[ Using " << Leon::Parse::GetCXString(clang_getClangVersion()) << " ]" << '\n';
+}
 
-		// Setup arguments
-		static_assert(sizeof(std::unique_ptr<char[]>) == sizeof(char *));
-		std::vector<std::unique_ptr<char[]>> args;
+// Get the arguments for a single file parse
+// Includes aren't read, so included headers are left out and the annotation macros are defined directly
+static std::vector<std::unique_ptr<char[]>> GetSingleFileArgs(const std::vector<std::unique_ptr<char[]>> &args)
+{
+	std::vector<std::unique_ptr<char[]>> single_file_args;
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		std::string arg = args[i].get();
+		if ((arg == "-include" || arg == "-include-pch") && i + 1 < args.size())
 		{
-			auto args_c = [&args](const char *str) -> void
-				{
-					size_t size = strlen(str) + 1;
-					std::unique_ptr<char[]> data = std::make_unique<char[]>(size);
-					memcpy(data.get(), str, size);
-					args.emplace_back(std::move(data));
-				};
-			auto args_s = [&args_c, &args](const std::string &str) -> void
-				{
-					args_c(str.c_str());
-				};
+			i++;
+			continue;
+		}
+		Leon::Arguments::Push(single_file_args, arg);
+	}
 
-			args_c("-x"); args_c("c++");
-			args_c("-std=c++20");
+	Leon::Arguments::Push(single_file_args, "-DLEON=__attribute__((annotate(\"@leon\")))");
+	Leon::Arguments::Push(single_file_args, "-DLEON_KV(key,value)=__attribute__((annotate(\"@leonkv \" #key \" \" #value)))");
+	Leon::Arguments::Push(single_file_args, "-DLEON_V(value)=__attribute__((annotate(\"@leonkv \" #value \" \\\"true\\\"\")))");
+	Leon::Arguments::Push(single_file_args, "-DLEON_SINGLE_FILE=");
 
-			args_c("-D_LEON_PROC");
+	return single_file_args;
+}
 
-			args_c("-fhosted");
-			args_c("-fcxx-exceptions");
-			args_c("-fexceptions");
+// Source argument
+struct SourceArgument
+{
+	StdPath std;
+	std::filesystem::path binary_dir;
+	std::filesystem::path out_name;
+	std::filesystem::path depfile_name;
+	std::filesystem::path model_name;
+	bool rebuild = false;
 
-			// Include our system headers
-#define LEON_SYSTEM_INCLUDE_FRAME(header) args_c("-isystem"); args_c( header );
-#include <LeonSystemIncludeFrame.h>
-#undef LEON_SYSTEM_INCLUDE_FRAME
+	// Cleared when the prescan finds no annotations, so the source doesn't need to be parsed
+	bool parse = true;
 
-			// Include our provided headers
-			for (auto &i : in_includes)
-				args_s(std::string("-I") + i);
+	// Arguments to parse the source with, and their hash for the manifest
+	std::vector<std::unique_ptr<char[]>> args;
+	Leon::Manifest::Hash args_hash = 0;
 
-			// Define our provided defines
-			for (auto &d : in_defines)
-				args_s(std::string("-D") + d);
-		}
+	// Parsed on its own without reading its includes, by -single_file or LEON_SINGLE_FILE
+	bool single_file = false;
+	std::vector<std::unique_ptr<char[]>> single_file_args;
 
-		// Decide where to put the glue
-		std::filesystem::path glue_name = binary_dir / ("glue" + glue_extension);
-		bool rebuild_glue = false;
+	// Parsed by the native frontend, so libclang doesn't need to see it
+	bool native = false;
 
-		if (!std::filesystem::exists(glue_name))
-			rebuild_glue = true;
-		else if (std::filesystem::last_write_time(lua_std.path) > std::filesystem::last_write_time(glue_name))
-			rebuild_glue = true;
+	// Given in memory by -overlay, so only libclang can read it
+	bool overlaid = false;
+};
 
-		// Parse source arguments
-		struct SourceArgument
-		{
-			StdPath std;
-			std::filesystem::path binary_dir;
-			std::filesystem::path out_name;
-			bool rebuild = false;
-		};
+// Get the targets and dependencies of the whole command, from the depfiles of each source
+// An empty glue name leaves the glue out, for commands that don't generate it
+static void GetCommandDependencies(const std::filesystem::path &glue_name, const StdPath &lua_std, const std::vector<SourceArgument> &source_args, std::vector<std::string> &targets, std::vector<std::string> &dependencies)
+{
+	if (!glue_name.empty())
+		targets.push_back(glue_name.string());
+	dependencies.push_back(lua_std.utf8);
+
+	for (auto &source : source_args)
+	{
+		targets.push_back(source.out_name.string());
+		if (!Leon::Depend::ReadDepfile(source.depfile_name, dependencies))
+			dependencies.push_back(source.std.utf8);
+	}
+}
 
-		std::vector<SourceArgument> source_args;
+// Write the depfile for the whole command
+static void WriteCommandDepfile(const std::filesystem::path &depfile_name, const std::filesystem::path &glue_name, const StdPath &lua_std, const std::vector<SourceArgument> &source_args)
+{
+	std::vector<std::string> targets;
+	std::vector<std::string> dependencies;
+	GetCommandDependencies(glue_name, lua_std, source_args, targets, dependencies);
+
+	Leon::Depend::WriteDepfile(depfile_name, targets, dependencies);
+}
+
+// Get the includes every given source starts with
+// A precompiled header can only be shared by sources parsed with the same arguments, otherwise there are none
+static std::vector<std::string> GetSharedIncludes(const std::vector<SourceArgument *> &sources)
+{
+	std::vector<std::string> shared;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (sources[i]->args_hash != sources[0]->args_hash)
+			return {};
 
-		for (; argi < argc; argi++)
+		auto includes = ScanIncludePrefix(sources[i]->std.path);
+		if (i == 0)
 		{
-			auto sources = ParseCMakeList(std::string(argv[argi]));
-			for (auto &i : sources)
-			{
-				// Get standard path of source file
-				SourceArgument source_arg;
-				source_arg.std = GetStdPath(i);
+			shared = std::move(includes);
+			continue;
+		}
 
-				// Get the binary path of the source file
-				std::filesystem::path in_path = source_arg.std.path;
-				CleanPath(in_path);
+		// Trim to the common prefix
+		size_t common = 0;
+		while (common < shared.size() && common < includes.size() && shared[common] == includes[common])
+			common++;
+		shared.resize(common);
+	}
+	return shared;
+}
 
-				source_arg.binary_dir = binary_dir / in_path;
-				std::filesystem::create_directories(source_arg.binary_dir);
+// Hash the includes a header is precompiled from and the arguments they're precompiled with
+// The overlay may replace any of the includes, so it's part of the hash too
+static Leon::Manifest::Hash GetPrecompiledHeaderHash(const std::vector<std::string> &includes, const SourceArgument &first, const Leon::Overlay::Overlay &overlay)
+{
+	Leon::Manifest::Hash hash = first.args_hash;
+	for (auto &i : includes)
+		hash = Leon::Manifest::HashString(i, hash);
+	for (auto &i : overlay.GetFiles())
+		hash = Leon::Manifest::HashString(i.second, Leon::Manifest::HashString(i.first, hash));
+	return hash;
+}
 
-				// Check if we should rebuild the output file
-				source_arg.out_name = source_arg.binary_dir / ("out" + out_extension);
+// Precompile the includes shared by a target's sources, for its per source commands to parse with
+// The header is only rebuilt when the includes or anything they include changes, so the commands using it aren't rerun for nothing.
+// With nothing to share, it's left empty.
+static void BuildSharedPrecompiledHeader(const std::filesystem::path &pch_name, const std::filesystem::path &depfile_name, std::vector<SourceArgument> &source_args, bool prescan, Leon::Manifest::Manifest &manifest, const std::filesystem::path &manifest_name, const Leon::Overlay::Overlay &overlay)
+{
+	// Only the sources the per source commands parse with libclang would load it
+	std::vector<SourceArgument *> sources;
+	for (auto &i : source_args)
+	{
+		if (i.single_file || i.overlaid)
+			continue;
 
-				if (!std::filesystem::exists(source_arg.out_name))
-				{
-					source_arg.rebuild = true;
-				}
-				else
-				{
-					bool source_modified = std::filesystem::last_write_time(source_arg.std.path) > std::filesystem::last_write_time(source_arg.out_name);
-					bool process_modified = std::filesystem::last_write_time(lua_std.path) > std::filesystem::last_write_time(source_arg.out_name);
+		auto scan = Leon::Prescan::Scan(i.std.path);
+		if ((prescan && !scan.annotations) || scan.single_file)
+			continue;
+		sources.push_back(&i);
+	}
 
-					if (source_modified || process_modified)
-						source_arg.rebuild = true;
-				}
+	// A single source has nothing to share
+	std::vector<std::string> includes;
+	if (sources.size() > 1)
+		includes = GetSharedIncludes(sources);
 
-				source_args.emplace_back(std::move(source_arg));
-			}
-		}
+	Leon::Manifest::Hash pch_hash = includes.empty() ? 0 : GetPrecompiledHeaderHash(includes, *sources[0], overlay);
+	if (std::filesystem::exists(pch_name) && (depfile_name.empty() || std::filesystem::exists(depfile_name)) && manifest.IsCurrent("pch", 0, pch_hash))
+	{
+		std::cout << "[ Shared includes up to date ]" << '\n';
+		return;
+	}
 
-		if (source_args.size() == 0)
-			throw std::runtime_error("Given no sources.");
+	std::vector<std::string> inclusions;
+	bool built = false;
+	if (!includes.empty())
+	{
+		PrintClangVersion();
+		std::cout << "[ Precompiling " << includes.size() << " shared include(s) ]" << '\n';
 
-		// Load and compile lua source
-		std::stringstream lua_sstream;
-		{
-			std::ifstream lua_stream(lua_std.path);
-			lua_sstream << lua_stream.rdbuf();
-		}
+		built = BuildPrecompiledHeader(pch_name, includes, sources[0]->args, overlay, &inclusions);
+		if (!built)
+			std::cout << "[ Failed to precompile shared includes, parsing without ]" << '\n';
+	}
+	else
+	{
+		std::cout << "[ No shared includes to precompile ]" << '\n';
+	}
 
-		std::unique_ptr<lua_State, void (*)(lua_State *)> GL(luaL_newstate(), lua_close);
-		luaL_openlibs(GL.get());
+	if (!built)
+	{
+		std::ofstream pch_stream(pch_name, std::ios::binary | std::ios::trunc);
+		if (!pch_stream)
+			throw std::runtime_error("Failed to write precompiled header: " + pch_name.string());
+	}
 
-		lua_State *L = lua_newthread(GL.get());
+	// A header that failed is tried again next time, rather than waiting for its includes to change
+	if (built || includes.empty())
+		manifest.Update("pch", 0, pch_hash, inclusions);
+	else
+		manifest.Remove("pch");
+	manifest.Save(manifest_name);
 
-		std::string bytecode = Luau::compile(lua_sstream.str());
-		if (luau_load(L, "=in", bytecode.data(), bytecode.size(), 0) != 0)
-		{
-			size_t len;
-			const char *msg = lua_tolstring(L, -1, &len);
+	if (!depfile_name.empty())
+		Leon::Depend::WriteDepfile(depfile_name, { pch_name.string() }, inclusions);
+}
 
-			std::string error(msg, len);
-			lua_pop(L, 1);
+// Work shared between the targets of a batch
+// Each target runs as if it was its own command, a lone command is a batch of one
+struct Batch
+{
+	// Run from a batch file
+	bool batched = false;
 
-			throw std::runtime_error("Lua process failed to compile: " + error);
-		}
+	// Compiled Lua processes, by the hash of their source
+	std::unordered_map<Leon::Manifest::Hash, std::unique_ptr<Leon::Process::Script>> scripts;
 
-		// Setup thread
-		// The stack now contains the function that will execute the loaded bytecode
-		lua_State *T = lua_newthread(L);
-		lua_pushvalue(L, -2);
-		lua_remove(L, -3);
-		lua_xmove(L, T, 1);
+	// Index for parsing outside of the workers, created once something is parsed
+	CXIndex index = nullptr;
 
-		int thread_status = lua_resume(T, nullptr, 0);
+	// Shared includes already precompiled, by the hash of the includes and the arguments they were precompiled with
+	std::unordered_map<Leon::Manifest::Hash, std::filesystem::path> pchs;
 
-		lua_pop(L, 1); // Remove thread off main stack
+	// Whether our libclang can load the precompiled headers of compile commands
+	std::unordered_map<std::string, bool> usable_pchs;
 
-		if (thread_status != LUA_OK)
-		{
-			std::string error;
-			if (thread_status == LUA_YIELD)
-				error = "thread yielded unexpectedly";
-			else if (const char *str = lua_tostring(T, -1))
-				error = str;
+	// Depfile of the whole batch
+	bool collect_dependencies = false;
+	std::vector<std::string> depfile_targets;
+	std::vector<std::string> depfile_dependencies;
 
-			error += "\nstack backtrace:\n";
-			error += lua_debugtrace(T);
+	// Whether any target had something to regenerate
+	bool regenerated = false;
 
-			throw std::runtime_error("Lua process failed to execute: " + error);
-		}
+	Batch() = default;
+	Batch(const Batch &) = delete;
+	Batch &operator=(const Batch &) = delete;
+
+	~Batch()
+	{
+		if (index != nullptr)
+			clang_disposeIndex(index);
+	}
+
+	CXIndex GetIndex()
+	{
+		if (index == nullptr)
+			index = clang_createIndex(0, 0);
+		return index;
+	}
+
+	Leon::Process::Script &GetScript(Leon::Manifest::Hash hash, const std::string &source)
+	{
+		auto it = scripts.find(hash);
+		if (it == scripts.end())
+			it = scripts.emplace(hash, std::make_unique<Leon::Process::Script>(source)).first;
+		return *it->second;
+	}
+};
+
+// Parse a source in libclang
+// A single file parse doesn't read the source's includes, registering what it can't resolve as opaque
+static void ParseSource(CXIndex index, const std::filesystem::path &path, const std::vector<std::unique_ptr<char[]>> &args, const Leon::Overlay::Overlay &overlay, Leon::Parse::Context &context, std::vector<std::string> &dependencies, std::ostream &diagnostics, bool single_file = false)
+{
+	CXTranslationUnit tu;
+	CXErrorCode ec;
+
+	// Load up the source file
+	int flags = CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete;
+	if (single_file)
+		flags |= CXTranslationUnit_SingleFileParse;
+
+	ec = clang_parseTranslationUnit2(index, path.string().c_str(), reinterpret_cast<const char *const *>(args.data()), args.size(), overlay.GetUnsavedFiles(), overlay.GetNumUnsavedFiles(), static_cast<CXTranslationUnit_Flags>(flags), &tu);
+
+	try
+	{
+		Leon::Parse::CheckTranslationUnit(tu, ec, diagnostics, single_file);
+	}
+	catch (...)
+	{
+		clang_disposeTranslationUnit(tu);
+		throw;
+	}
+
+	// Parse the AST
+	CXCursor rootCursor = clang_getTranslationUnitCursor(tu);
+
+	context.lenient = single_file;
+	clang_visitChildren(rootCursor, Leon::Parse::Visitor, &context);
+
+	// Get the files the output depends on
+	dependencies = Leon::Depend::GetInclusions(tu);
+
+	clang_disposeTranslationUnit(tu);
+}
 
-		// Check for the table off the stack
-		if (lua_gettop(T) == 0 || !lua_istable(T, -1))
-			throw std::runtime_error("Lua process did not return `table`");
+// Parse a source file through the indexer
+// The action keeps an indexing session, so bodies already parsed by an earlier source of the session aren't parsed again
+static void IndexSource(CXIndexAction action, const std::filesystem::path &path, const std::vector<std::unique_ptr<char[]>> &args, const Leon::Overlay::Overlay &overlay, Leon::Parse::Context &context, std::vector<std::string> &dependencies, std::ostream &diagnostics)
+{
+	// Exceptions can't be thrown through libclang, so they're held until indexing returns
+	struct IndexClient
+	{
+		Leon::Parse::Context &context;
+		std::exception_ptr error;
+	} client{context, nullptr};
 
-		// Parse sources
-		for (auto &source : source_args)
+	IndexerCallbacks callbacks = {};
+	callbacks.abortQuery = [](CXClientData client_data, void *) -> int
 		{
-			// Get shorthand name
-			std::string short_name = source.std.path.filename().string();
+			auto &client = *(reinterpret_cast<IndexClient *>(client_data));
+			return client.error != nullptr;
+		};
+	callbacks.indexDeclaration = [](CXClientData client_data, const CXIdxDeclInfo *info) -> void
+		{
+			auto &client = *(reinterpret_cast<IndexClient *>(client_data));
+			if (client.error != nullptr)
+				return;
 
-			if (!source.rebuild)
+			try
 			{
-				std::cout << "[ `" << short_name << "` up to date ]" << '\n';
-				continue;
+				Leon::Parse::IndexDeclaration(client.context, info);
 			}
-			else
+			catch (...)
 			{
-				std::cout << "[ Generating `" << short_name << "` ]" << '\n';
+				client.error = std::current_exception();
 			}
+		};
 
-			// Parse in libclang
-			{
-				CXIndex index = clang_createIndex(0, 0);
-				CXTranslationUnit tu;
-				CXErrorCode ec;
+	CXTranslationUnit tu = nullptr;
+	CXErrorCode ec;
 
-				// Load up the source file
-				CXTranslationUnit_Flags flags = static_cast<CXTranslationUnit_Flags>(CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete);
-				ec = clang_parseTranslationUnit2(index, source.std.path.string().c_str(), reinterpret_cast<const char *const *>(args.data()), args.size(), nullptr, 0, flags, &tu);
-				
-				// Check diagnostics
-				size_t num_diagnostics = clang_getNumDiagnostics(tu);
-				if (num_diagnostics != 0)
-				{
-					std::cout << std::flush;
+	// Load up the source file
+	// Our arguments don't start with a program name, so they're given like clang_parseTranslationUnit2's rather than as a full argv
+	CXTranslationUnit_Flags flags = static_cast<CXTranslationUnit_Flags>(CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete);
+	ec = static_cast<CXErrorCode>(clang_indexSourceFile(action, &client, &callbacks, sizeof(callbacks), CXIndexOpt_SkipParsedBodiesInSession, path.string().c_str(), reinterpret_cast<const char *const *>(args.data()), args.size(), overlay.GetUnsavedFiles(), overlay.GetNumUnsavedFiles(), &tu, flags));
 
-					for (unsigned int i = 0; i < num_diagnostics; i++)
-					{
-						auto diagnostic = clang_getDiagnostic(tu, i);
-						auto severity = clang_getDiagnosticSeverity(diagnostic);
-						switch (severity)
-						{
-							case CXDiagnostic_Ignored:
-								break;
-							case CXDiagnostic_Note:
-							case CXDiagnostic_Warning:
-							case CXDiagnostic_Error:
-							case CXDiagnostic_Fatal:
-								std::cerr << Leon::Parse::GetCXString(clang_formatDiagnostic(diagnostic, clang_defaultDiagnosticDisplayOptions())) << '\n';
-								break;
-						}
-						clang_disposeDiagnostic(diagnostic);
-
-						if (severity == CXDiagnostic_Error || severity == CXDiagnostic_Fatal)
-							throw std::runtime_error("Source parsing ran into a fatal error. See above.");
-					}
+	try
+	{
+		Leon::Parse::CheckTranslationUnit(tu, ec, diagnostics);
+		if (client.error)
+			std::rethrow_exception(client.error);
+	}
+	catch (...)
+	{
+		clang_disposeTranslationUnit(tu);
+		throw;
+	}
 
-					std::cerr << std::flush;
-				}
+	// Get the files the output depends on
+	dependencies = Leon::Depend::GetInclusions(tu);
 
-				// Check if the translation unit failed, but wasn't caught by a diagnostic
-				if (ec != CXError_Success)
-				{
-					std::string problem;
-					switch (ec)
-					{
-						case CXError_Failure:
-							problem = "Failure";
-							break;
-						case CXError_Crashed:
-							problem = "Crashed";
-							break;
-						case CXError_InvalidArguments:
-							problem = "Invalid Arguments";
-							break;
-						case CXError_ASTReadError:
-							problem = "AST Read Error";
-							break;
-						default:
-							problem = std::to_string(ec);
-							break;
-					}
-					throw std::runtime_error(problem + " wasn't caught by a diagnostic.");
-				}
+	clang_disposeTranslationUnit(tu);
+}
 
-				// Parse the AST
-				Leon::Parse::Reset();
+// Parsing frontend
+enum class Frontend
+{
+	Parse, // clang_parseTranslationUnit2 and clang_visitChildren
+	Index, // clang_indexSourceFileFullArgv
+};
 
-				CXCursor rootCursor = clang_getTranslationUnitCursor(tu);
+// Source parse result
+struct SourceParse
+{
+	Leon::Parse::Context context;
+	std::vector<std::string> dependencies;
+	std::string diagnostics;
+	std::exception_ptr error;
 
-				unsigned int treeLevel = 0;
+	std::chrono::steady_clock::duration parse_time = {};
 
-				clang_visitChildren(rootCursor, Leon::Parse::Visitor, &treeLevel);
+	// Time a full parse of a single file source takes, when comparing the two
+	std::chrono::steady_clock::duration full_parse_time = {};
+};
 
-				clang_disposeTranslationUnit(tu);
-				clang_disposeIndex(index);
-			}
+// Write an output file
+static void WriteOutput(const std::filesystem::path &path, const std::string &output)
+{
+	std::ofstream output_stream(path, std::ios::binary);
+	if (!output_stream)
+		throw std::runtime_error("Failed to open output: " + path.string());
 
-			// Process in Lua process
-			{
-				// Get SourceProcess function
-				lua_pushstring(T, "SourceProcess");
-				lua_gettable(T, -2);
+	output_stream.write(output.data(), output.size());
+}
 
-				// Run SourceProcess
-				lua_pushstring(T, source.std.utf8.c_str()); // source
-				Leon::Process::ConstructLuaTables(T); // types, enums, classes, functions
+// Write the model of a single source, exported along with the rest of its target's
+// Returns whether the model changed, and with it the declarations the glue is given
+static bool WriteSourceModel(const std::filesystem::path &model_name, const Leon::Parse::Context &context)
+{
+	Leon::Model::Model model;
+	model.Add(context);
+	return model.Save(model_name);
+}
 
-				thread_status = lua_pcall(T, 5, 1, 0);
+// Get the models of every source, the glue has to be regenerated when they change
+static std::vector<std::string> GetSourceModelNames(const std::vector<SourceArgument> &source_args)
+{
+	std::vector<std::string> model_names;
+	for (auto &source : source_args)
+		model_names.push_back(GetStdPath(source.model_name.string()).utf8);
+	return model_names;
+}
 
-				if (thread_status == 0)
-				{
-					// Get result string
-					if (!lua_isstring(T, -1))
-						throw std::runtime_error("Lua process did not return `string`");
-					std::string output = lua_tostring(T, -1);
-					lua_pop(T, 1);
-
-					// Write output file
-					std::ofstream output_stream(source.out_name, std::ios::binary);
-					if (!output_stream)
-						throw std::runtime_error("Failed to open output: " + source.out_name.string());
-
-					output_stream.write(output.data(), output.size());
-				}
-				else
-				{
-					std::string error;
-					if (thread_status == LUA_YIELD)
-						error = "thread yielded unexpectedly";
-					else if (const char *str = lua_tostring(T, -1))
-						error = str;
+// Get the model of a whole target, from the models of each source
+// Each declaration is recorded once, with the sources referencing it
+static Leon::Model::Model GetTargetModel(const std::vector<SourceArgument> &source_args)
+{
+	Leon::Model::Model model;
+	for (auto &source : source_args)
+	{
+		Leon::Model::Model source_model;
+		if (!source_model.Load(source.model_name))
+			throw std::runtime_error("Failed to load model: " + source.model_name.string());
+		model.Merge(source_model, source.std.utf8);
+	}
+	return model;
+}
 
-					error += "\nstack backtrace:\n";
-					error += lua_debugtrace(T);
+// Hash the list of sources
+static Leon::Manifest::Hash GetSourcesHash(const std::vector<SourceArgument> &source_args)
+{
+	Leon::Manifest::Hash hash = Leon::Manifest::HashBytes(nullptr, 0);
+	for (auto &source : source_args)
+		hash = Leon::Manifest::HashString(source.std.utf8, hash);
+	return hash;
+}
 
-					throw std::runtime_error("Lua process failed to execute: " + error);
-				}
-			}
-		}
+// Export the model of a target
+// The export is recorded in the manifest like the glue, so up to date runs don't have to load every source's model.
+// Pass force when a source's model was written by this run, the manifest may have already found it current.
+static void ExportModel(const std::filesystem::path &export_model_name, const std::vector<SourceArgument> &source_args, Leon::Manifest::Manifest &manifest, bool force)
+{
+	// The export doesn't exist before the first run, so its path is standardized without requiring it to
+	Leon::Manifest::Hash export_hash = Leon::Manifest::HashString(Leon::Overlay::Overlay::GetPath(export_model_name.string()), GetSourcesHash(source_args));
+	if (!force && std::filesystem::exists(export_model_name) && manifest.IsCurrent("model", 0, export_hash))
+		return;
 
-		// Generate glue
-		if (!rebuild_glue)
-		{
-			std::cout << "[ `glue` up to date ]" << '\n';
-		}
-		else
-		{
-			std::cout << "[ Generating `glue` ]" << '\n';
+	GetTargetModel(source_args).Save(export_model_name);
+	manifest.Update("model", 0, export_hash, GetSourceModelNames(source_args));
+}
 
-			// Get GlueProcess function
-			lua_pushstring(T, "GlueProcess");
-			lua_gettable(T, -2);
+// Get the sources to pass to GlueProcess
+static std::vector<Leon::Process::GlueSource> GetGlueSources(const std::vector<SourceArgument> &source_args)
+{
+	std::vector<Leon::Process::GlueSource> sources;
+	for (auto &source : source_args)
+		sources.push_back({ source.std.utf8, GetStdPath(source.out_name.string()).utf8 });
+	return sources;
+}
 
-			// Build sources table
-			lua_newtable(T);
+// Watch sources for changes
+// Keeps the Lua process and every translation unit loaded, reparsing sources as they're modified.
+// This keeps the outputs current, so that builds find them up to date.
+// With watch_overlay, overlay records piped to stdin replace files as they arrive, like an editor's unsaved buffers.
+static void WatchSources(const std::vector<SourceArgument> &source_args, const StdPath &lua_std, const std::filesystem::path &glue_name, bool rebuild_glue, const std::filesystem::path &export_model_name, Leon::Manifest::Manifest &manifest, const std::filesystem::path &manifest_name, Leon::Overlay::Overlay &overlay, bool watch_overlay)
+{
+	struct WatchedSource
+	{
+		CXTranslationUnit tu = nullptr;
+		std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> dependencies;
 
-			int source_i = 1;
-			for (auto &source : source_args)
-			{
-				lua_pushnumber(T, source_i++);
-				lua_newtable(T);
+		// Every file the source depends on, including those only in the overlay
+		std::vector<std::string> files;
+	};
 
-				Leon::Process::LuaTableSetString(T, -1, "source", source.std.utf8.c_str());
+	std::vector<WatchedSource> watched(source_args.size());
 
-				StdPath out_std_path = GetStdPath(source.out_name.string());
-				Leon::Process::LuaTableSetString(T, -1, "out", out_std_path.utf8.c_str());
+	CXIndex index = clang_createIndex(0, 0);
 
-				lua_settable(T, -3);
-			}
+	// Load the Lua process
+	std::filesystem::file_time_type lua_write_time;
+	Leon::Manifest::Hash script_hash;
+	std::unique_ptr<Leon::Process::Script> script;
 
-			// Run SourceProcess
-			thread_status = lua_pcall(T, 1, 1, 0);
+	auto load_script = [&]() -> void
+		{
+			lua_write_time = std::filesystem::last_write_time(lua_std.path);
 
-			if (thread_status == 0)
+			std::stringstream lua_sstream;
 			{
-				// Get result string
-				if (!lua_isstring(T, -1))
-					throw std::runtime_error("Lua process did not return `string`");
-				std::string output = lua_tostring(T, -1);
+				std::ifstream lua_stream(lua_std.path);
+				lua_sstream << lua_stream.rdbuf();
+			}
+
+			script = std::make_unique<Leon::Process::Script>(lua_sstream.str());
+			script_hash = Leon::Manifest::HashString(lua_sstream.str());
+		};
 
-				// Write output file
-				std::ofstream output_stream(glue_name, std::ios::binary);
-				if (!output_stream)
-					throw std::runtime_error("Failed to open output: " + glue_name.string());
+	// Remember the write times of everything a source includes
+	auto watch_dependencies = [&](size_t i) -> void
+		{
+			auto &watch = watched[i];
+			watch.dependencies.clear();
 
-				output_stream.write(output.data(), output.size());
-			}
-			else
+			std::vector<std::string> dependencies = { source_args[i].std.utf8 };
+			if (watch.tu != nullptr)
 			{
-				std::string error;
-				if (thread_status == LUA_YIELD)
-					error = "thread yielded unexpectedly";
-				else if (const char *str = lua_tostring(T, -1))
-					error = str;
+				auto inclusions = Leon::Depend::GetInclusions(watch.tu);
+				dependencies.insert(dependencies.end(), inclusions.begin(), inclusions.end());
+			}
+			watch.files = dependencies;
 
-				error += "\nstack backtrace:\n";
-				error += lua_debugtrace(T);
+			for (auto &d : dependencies)
+			{
+				std::error_code ec;
+				auto time = std::filesystem::last_write_time(std::filesystem::path(d), ec);
+				if (!ec)
+					watch.dependencies.emplace_back(std::filesystem::path(d), time);
+			}
+		};
 
-				throw std::runtime_error("Lua process failed to execute: " + error);
+	auto is_modified = [&](size_t i) -> bool
+		{
+			for (auto &d : watched[i].dependencies)
+			{
+				std::error_code ec;
+				auto time = std::filesystem::last_write_time(d.first, ec);
+				if (ec || time != d.second)
+					return true;
 			}
-		}
+			return false;
+		};
+
+	// Parse or reparse a source and regenerate its output
+	// Returns whether the source's model changed, so the glue has to be regenerated
+	auto generate = [&](size_t i) -> bool
+		{
+			auto &source = source_args[i];
+			auto &watch = watched[i];
+
+			std::string short_name = source.std.path.filename().string();
+			std::cout << "[ Generating `" << short_name << "` ]" << std::endl;
+
+			std::ostringstream diagnostics;
+			try
+			{
+				CXErrorCode ec;
+				if (watch.tu == nullptr)
+				{
+					// Keep the preamble around so reparsing only has to process the source itself
+					CXTranslationUnit_Flags flags = static_cast<CXTranslationUnit_Flags>(CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete | CXTranslationUnit_PrecompiledPreamble | CXTranslationUnit_CreatePreambleOnFirstParse);
+					ec = clang_parseTranslationUnit2(index, source.std.path.string().c_str(), reinterpret_cast<const char *const *>(source.args.data()), source.args.size(), overlay.GetUnsavedFiles(), overlay.GetNumUnsavedFiles(), flags, &watch.tu);
+				}
+				else
+				{
+					ec = static_cast<CXErrorCode>(clang_reparseTranslationUnit(watch.tu, overlay.GetNumUnsavedFiles(), overlay.GetUnsavedFiles(), clang_defaultReparseOptions(watch.tu)));
+				}
+
+				if (ec != CXError_Success)
+				{
+					// The translation unit can't be reused after a failure
+					clang_disposeTranslationUnit(watch.tu);
+					watch.tu = nullptr;
+				}
+				watch_dependencies(i);
+
+				Leon::Parse::CheckTranslationUnit(watch.tu, ec, diagnostics);
+
+				Leon::Parse::Context context;
+				clang_visitChildren(clang_getTranslationUnitCursor(watch.tu), Leon::Parse::Visitor, &context);
+
+				auto inclusions = Leon::Depend::GetInclusions(watch.tu);
+				WriteOutput(source.out_name, script->SourceProcess(source.std.utf8, context));
+				Leon::Depend::WriteDepfile(source.depfile_name, { source.out_name.string() }, inclusions);
+				bool model_changed = WriteSourceModel(source.model_name, context);
+				if (model_changed && !export_model_name.empty())
+					ExportModel(export_model_name, source_args, manifest, true);
+
+				manifest.Update(source.std.utf8, script_hash, source.args_hash, inclusions);
+				manifest.Save(manifest_name);
+				return model_changed;
+			}
+			catch (std::exception &e)
+			{
+				// Keep watching, the source may be fixed
+				std::cerr << diagnostics.str() << "[ `" << short_name << "` failed: " << e.what() << " ]" << std::endl;
+				return false;
+			}
+		};
+
+	auto generate_glue = [&]() -> void
+		{
+			std::cout << "[ Generating `glue` ]" << std::endl;
+			try
+			{
+				WriteOutput(glue_name, script->GlueProcess(GetGlueSources(source_args), GetTargetModel(source_args)));
+
+				manifest.Update("glue", script_hash, GetSourcesHash(source_args), GetSourceModelNames(source_args));
+				manifest.Save(manifest_name);
+			}
+			catch (std::exception &e)
+			{
+				std::cerr << "[ `glue` failed: " << e.what() << " ]" << std::endl;
+			}
+		};
+
+	// Generate what's out of date
+	load_script();
+
+	for (size_t i = 0; i < source_args.size(); i++)
+	{
+		if (source_args[i].rebuild)
+		{
+			if (generate(i))
+				rebuild_glue = true;
+		}
+		else
+		{
+			// Parse anyways, so the first change only needs a reparse
+			std::ostringstream diagnostics;
+			CXTranslationUnit_Flags flags = static_cast<CXTranslationUnit_Flags>(CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete | CXTranslationUnit_PrecompiledPreamble | CXTranslationUnit_CreatePreambleOnFirstParse);
+			auto &args = source_args[i].args;
+			if (clang_parseTranslationUnit2(index, source_args[i].std.path.string().c_str(), reinterpret_cast<const char *const *>(args.data()), args.size(), overlay.GetUnsavedFiles(), overlay.GetNumUnsavedFiles(), flags, &watched[i].tu) != CXError_Success)
+				watched[i].tu = nullptr;
+			watch_dependencies(i);
+		}
+	}
+
+	if (rebuild_glue)
+		generate_glue();
+
+	// Read overlay records off the pipe, they're applied between checks
+	std::mutex overlay_mutex;
+	std::vector<std::pair<std::string, std::string>> overlay_pending;
+
+	if (watch_overlay)
+	{
+		// Watching never returns, so the reader can be left blocked on stdin
+		std::thread([&]() -> void
+			{
+				try
+				{
+					std::string path, contents;
+					while (Leon::Overlay::Overlay::ReadRecord(std::cin, path, contents))
+					{
+						std::lock_guard<std::mutex> lock(overlay_mutex);
+						overlay_pending.emplace_back(std::move(path), std::move(contents));
+					}
+				}
+				catch (std::exception &e)
+				{
+					std::cerr << "[ Overlay failed: " << e.what() << " ]" << std::endl;
+				}
+			}).detach();
+	}
+
+	// Watch for changes
+	std::cout << "[ Watching " << source_args.size() << " source(s) ]" << std::endl;
+
+	while (1)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+		// Apply overlay records, marking the sources that depend on the files they replace
+		std::vector<std::pair<std::string, std::string>> overlay_records;
+		{
+			std::lock_guard<std::mutex> lock(overlay_mutex);
+			overlay_records.swap(overlay_pending);
+		}
+
+		std::vector<bool> overlay_modified(source_args.size(), false);
+		for (auto &record : overlay_records)
+		{
+			std::string path = Leon::Overlay::Overlay::GetPath(record.first);
+			manifest.Override(path, record.second);
+			overlay.Set(path, std::move(record.second));
+
+			for (size_t i = 0; i < source_args.size(); i++)
+			{
+				if (std::find(watched[i].files.begin(), watched[i].files.end(), path) != watched[i].files.end())
+					overlay_modified[i] = true;
+			}
+		}
+
+		std::error_code ec;
+		auto time = std::filesystem::last_write_time(lua_std.path, ec);
+		if (!ec && time != lua_write_time)
+		{
+			// The Lua process changed, so everything has to be regenerated
+			try
+			{
+				load_script();
+			}
+			catch (std::exception &e)
+			{
+				std::cerr << "[ Lua process failed: " << e.what() << " ]" << std::endl;
+				continue;
+			}
+
+			for (size_t i = 0; i < source_args.size(); i++)
+				generate(i);
+			generate_glue();
+			continue;
+		}
+
+		bool glue_modified = false;
+		for (size_t i = 0; i < source_args.size(); i++)
+		{
+			if ((overlay_modified[i] || is_modified(i)) && generate(i))
+				glue_modified = true;
+		}
+		if (glue_modified)
+			generate_glue();
+	}
+}
+
+// Take the parses of sources from ASTs serialized by the compiler
+// Each source is taken from the first AST that includes it, sources not in any AST are left to be parsed
+static void LoadASTs(CXIndex index, const std::vector<std::filesystem::path> &ast_names, const std::vector<SourceArgument> &sources, std::vector<std::unique_ptr<SourceParse>> &results)
+{
+	for (auto &ast_name : ast_names)
+	{
+		CXTranslationUnit tu;
+		CXErrorCode ec = clang_createTranslationUnit2(index, ast_name.string().c_str(), &tu);
+		if (ec != CXError_Success)
+			throw std::runtime_error("Failed to load AST: " + ast_name.string());
+
+		// Find the sources this AST has and hasn't already been taken from another
+		std::vector<std::pair<size_t, CXFile>> files;
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			// The compiler serialized what's on disk, not what's overlaid
+			if (!sources[i].rebuild || !sources[i].parse || sources[i].overlaid || results[i] != nullptr)
+				continue;
+
+			CXFile file = clang_getFile(tu, sources[i].std.utf8.c_str());
+			if (file == nullptr)
+				continue;
+
+			files.emplace_back(i, file);
+			results[i] = std::make_unique<SourceParse>();
+		}
+
+		if (!files.empty())
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			std::ostringstream diagnostics;
+			try
+			{
+				Leon::Parse::CheckTranslationUnit(tu, ec, diagnostics);
+
+				Leon::Parse::VisitTranslationUnit(tu, [&](CXFile file) -> Leon::Parse::Context *
+					{
+						for (auto &i : files)
+							if (clang_File_isEqual(file, i.second))
+								return &results[i.first]->context;
+						return nullptr;
+					});
+			}
+			catch (...)
+			{
+				results[files.front().first]->error = std::current_exception();
+			}
+			results[files.front().first]->diagnostics = diagnostics.str();
+
+			// The AST is rewritten whenever the compiler sees any of its includes change
+			auto parse_time = std::chrono::steady_clock::now() - start;
+			for (auto &i : files)
+			{
+				results[i.first]->dependencies = { sources[i.first].std.utf8, GetStdPath(ast_name.string()).utf8 };
+				results[i.first]->parse_time = parse_time / files.size();
+			}
+		}
+
+		clang_disposeTranslationUnit(tu);
+	}
+}
+
+// Parse sources sharing the same arguments as a single translation unit
+// Each declaration is registered into the context of the source it was declared in
+static void ParseUnityGroup(CXIndex index, const std::filesystem::path &unity_name, const std::vector<size_t> &unity_sources, const std::vector<SourceArgument> &sources, const Leon::Overlay::Overlay &overlay, std::vector<std::unique_ptr<SourceParse>> &results)
+{
+	// Write the umbrella source, line N includes unity_sources[N - 1]
+	{
+		std::ofstream unity_stream(unity_name, std::ios::binary);
+		if (!unity_stream)
+			throw std::runtime_error("Failed to open unity source: " + unity_name.string());
+
+		for (auto &i : unity_sources)
+		{
+			unity_stream << "#include \"" << sources[i].std.utf8 << "\"\n";
+			results[i] = std::make_unique<SourceParse>();
+		}
+	}
+
+	// Failures are reported through the first source
+	// Every source of the group has the same arguments, so the first source's are the translation unit's
+	auto &first = *results[unity_sources.front()];
+	auto &args = sources[unity_sources.front()].args;
+
+	// The translation unit is disposed however the parse ends, as registering declarations can throw too
+	std::ostringstream diagnostics;
+	CXTranslationUnit tu = nullptr;
+	try
+	{
+		CXErrorCode ec;
+
+		CXTranslationUnit_Flags flags = static_cast<CXTranslationUnit_Flags>(CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete);
+		ec = clang_parseTranslationUnit2(index, unity_name.string().c_str(), reinterpret_cast<const char *const *>(args.data()), args.size(), overlay.GetUnsavedFiles(), overlay.GetNumUnsavedFiles(), flags, &tu);
+
+		Leon::Parse::CheckTranslationUnit(tu, ec, diagnostics);
+
+		// Split the declarations back up by source
+		std::vector<CXFile> files;
+		for (auto &i : unity_sources)
+			files.push_back(clang_getFile(tu, sources[i].std.utf8.c_str()));
+
+		Leon::Parse::VisitTranslationUnit(tu, [&](CXFile file) -> Leon::Parse::Context *
+			{
+				for (size_t i = 0; i < files.size(); i++)
+					if (files[i] != nullptr && clang_File_isEqual(file, files[i]))
+						return &results[unity_sources[i]]->context;
+				return nullptr;
+			});
+
+		// Headers shared between sources are only reached through the first source that includes them,
+		// so each source also has to depend on everything the sources before it included
+		for (auto &i : Leon::Depend::GetMainInclusions(tu))
+		{
+			if (i.line == 0 || i.line > unity_sources.size())
+				continue;
+			for (size_t j = i.line - 1; j < unity_sources.size(); j++)
+				results[unity_sources[j]]->dependencies.push_back(i.name);
+		}
+	}
+	catch (...)
+	{
+		first.error = std::current_exception();
+	}
+	if (tu != nullptr)
+		clang_disposeTranslationUnit(tu);
+	first.diagnostics = diagnostics.str();
+}
+
+// Parse every source being rebuilt as few translation units as possible
+// Sources with different arguments (like from compile commands) can't share one, so there's one per set of arguments
+// Sources that already have a result are left out
+static void ParseUnity(CXIndex index, const std::filesystem::path &unity_name, const std::vector<SourceArgument> &sources, const Leon::Overlay::Overlay &overlay, std::vector<std::unique_ptr<SourceParse>> &results)
+{
+	// Groups are kept in the order of their first source, so unchanged arguments keep their umbrella source
+	std::vector<std::pair<Leon::Manifest::Hash, std::vector<size_t>>> groups;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (!sources[i].rebuild || !sources[i].parse || sources[i].single_file || results[i] != nullptr)
+			continue;
+
+		auto group = std::find_if(groups.begin(), groups.end(), [&](auto &g) { return g.first == sources[i].args_hash; });
+		if (group == groups.end())
+			group = groups.insert(groups.end(), { sources[i].args_hash, {} });
+		group->second.push_back(i);
+	}
+
+	for (size_t i = 0; i < groups.size(); i++)
+	{
+		// The first group keeps the plain name
+		std::filesystem::path group_name = unity_name;
+		if (i != 0)
+			group_name.replace_filename(unity_name.stem().string() + "_" + std::to_string(i) + unity_name.extension().string());
+
+		ParseUnityGroup(index, group_name, groups[i].second, sources, overlay, results);
+	}
+}
+
+// Parse worker pool
+// Workers claim sources in order and parse each into its own context.
+// Results are taken in that same order, so the output is identical to parsing serially.
+class ParsePool
+{
+	private:
+		Batch &batch;
+		const std::vector<SourceArgument> &sources;
+		const Leon::Overlay::Overlay &overlay;
+		Frontend frontend;
+		bool compare_single_file;
+
+		// Serial parsing, with the batch's index
+		CXIndex index = nullptr;
+		CXIndexAction action = nullptr;
+
+		// Parallel parsing
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<SourceParse>> results;
+
+		std::atomic<size_t> next = 0;
+		std::mutex mutex;
+		std::condition_variable cv;
+
+		std::unique_ptr<SourceParse> Parse(CXIndex parse_index, CXIndexAction parse_action, size_t i)
+		{
+			auto result = std::make_unique<SourceParse>();
+			auto start = std::chrono::steady_clock::now();
+
+			std::ostringstream diagnostics;
+			try
+			{
+				if (sources[i].single_file)
+					ParseSource(parse_index, sources[i].std.path, sources[i].single_file_args, overlay, result->context, result->dependencies, diagnostics, true);
+				else if (frontend == Frontend::Index)
+					IndexSource(parse_action, sources[i].std.path, sources[i].args, overlay, result->context, result->dependencies, diagnostics);
+				else
+					ParseSource(parse_index, sources[i].std.path, sources[i].args, overlay, result->context, result->dependencies, diagnostics);
+			}
+			catch (...)
+			{
+				result->error = std::current_exception();
+			}
+			result->diagnostics = diagnostics.str();
+			result->parse_time = std::chrono::steady_clock::now() - start;
+
+			// Time the full parse the single file parse replaced, its results are thrown away
+			if (compare_single_file && sources[i].single_file && !result->error)
+			{
+				auto full_start = std::chrono::steady_clock::now();
+				try
+				{
+					Leon::Parse::Context full_context;
+					std::vector<std::string> full_dependencies;
+					std::ostringstream full_diagnostics;
+					ParseSource(parse_index, sources[i].std.path, sources[i].args, overlay, full_context, full_dependencies, full_diagnostics);
+				}
+				catch (...)
+				{
+				}
+				result->full_parse_time = std::chrono::steady_clock::now() - full_start;
+			}
+
+			return result;
+		}
+
+		void Worker()
+		{
+			// Each worker gets its own index, as they can't be shared between threads
+			CXIndex worker_index = clang_createIndex(0, 0);
+			CXIndexAction worker_action = (frontend == Frontend::Index) ? clang_IndexAction_create(worker_index) : nullptr;
+
+			while (1)
+			{
+				size_t i = next++;
+				if (i >= sources.size())
+					break;
+				if (!sources[i].rebuild || !sources[i].parse)
+					continue;
+
+				// Sources parsed natively or taken from an AST were filled in before the workers started
+				if (results[i] != nullptr)
+					continue;
+
+				auto result = Parse(worker_index, worker_action, i);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					results[i] = std::move(result);
+				}
+				cv.notify_all();
+			}
+
+			if (worker_action != nullptr)
+				clang_IndexAction_dispose(worker_action);
+			clang_disposeIndex(worker_index);
+		}
+
+	public:
+		ParsePool(Batch &_batch, const std::vector<SourceArgument> &_sources, const Leon::Overlay::Overlay &_overlay, std::vector<std::unique_ptr<SourceParse>> &&_results, unsigned int jobs, Frontend _frontend, const std::filesystem::path &unity_name, const std::vector<std::filesystem::path> &ast_names, bool _compare_single_file) : batch(_batch), sources(_sources), overlay(_overlay), frontend(_frontend), compare_single_file(_compare_single_file), results(std::move(_results))
+		{
+			// Take what we can from the compiler's ASTs
+			if (!ast_names.empty())
+			{
+				index = batch.GetIndex();
+				LoadASTs(index, ast_names, sources, results);
+			}
+
+			// Parse everything else up front as one translation unit
+			if (!unity_name.empty())
+			{
+				index = batch.GetIndex();
+				ParseUnity(index, unity_name, sources, overlay, results);
+			}
+
+			// Sources without annotations have an empty parse, and only depend on themselves
+			size_t num_parse = 0;
+			for (size_t i = 0; i < sources.size(); i++)
+			{
+				if (!sources[i].rebuild || results[i] != nullptr)
+					continue;
+
+				if (sources[i].parse)
+				{
+					num_parse++;
+					continue;
+				}
+
+				results[i] = std::make_unique<SourceParse>();
+				results[i]->dependencies.push_back(sources[i].std.utf8);
+			}
+
+			// Single file sources left out of the unity parse are parsed as they're taken
+			if (!unity_name.empty())
+				return;
+
+			// Don't spin up more workers than there are sources to parse
+			if (jobs > num_parse)
+				jobs = static_cast<unsigned int>(num_parse);
+
+			if (jobs <= 1)
+			{
+				if (num_parse == 0)
+					return;
+				index = batch.GetIndex();
+				if (frontend == Frontend::Index)
+					action = clang_IndexAction_create(index);
+				return;
+			}
+
+			for (unsigned int i = 0; i < jobs; i++)
+				workers.emplace_back(&ParsePool::Worker, this);
+		}
+
+		~ParsePool()
+		{
+			// Stop claiming sources and wait for the workers to finish
+			next = sources.size();
+			for (auto &i : workers)
+				i.join();
+
+			if (action != nullptr)
+				clang_IndexAction_dispose(action);
+		}
+
+		// Get the parse result of a source
+		std::unique_ptr<SourceParse> Take(size_t i)
+		{
+			if (workers.empty())
+			{
+				if (results[i] != nullptr)
+					return std::move(results[i]);
+				return Parse(index, action, i);
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&]() { return results[i] != nullptr; });
+			return std::move(results[i]);
+		}
+};
+
+// Run a single target, the arguments are those of a whole command
+static int RunTarget(int argc, char **argv, Batch &batch)
+{
+	auto start_time = std::chrono::steady_clock::now();
+
+	if (argc < 4)
+	{
+		std::cout << "Usage: " << argv[0] << " <binary_dir> <process.lua> [options] <source>" << '\n';
+		std::cout << "       " << argv[0] << " <binary_dir> <process.lua> [options] -no_glue -manifest <manifest> <source>" << '\n';
+		std::cout << "       " << argv[0] << " <binary_dir> <process.lua> [options] -glue_only <source>" << '\n';
+		std::cout << "       " << argv[0] << " <binary_dir> <process.lua> [options] -shard <i>/<n> <source>" << '\n';
+		std::cout << "       " << argv[0] << " <binary_dir> <process.lua> [options] -merge <source>" << '\n';
+		std::cout << "       " << argv[0] << " -batch <batch.txt> [-depfile <depfile>]" << std::endl;
+		return -1;
+	}
+
+	int argi = 1;
+
+	std::filesystem::path binary_dir = std::filesystem::path(std::string(argv[argi++]));
+	StdPath lua_std = GetStdPath(argv[argi++]);
+
+	if (batch.batched)
+		std::cout << "[ Target `" << binary_dir.string() << "` ]" << '\n';
+
+	std::vector<std::string> in_includes;
+	std::vector<std::string> in_defines;
+
+	std::vector<StdPath> source_std;
+
+	// Create project directory
+	std::filesystem::create_directories(binary_dir);
+	
+	// Parse options
+	std::string out_extension, glue_extension;
+	unsigned int jobs = 1;
+	bool use_pch = true;
+	bool watch = false;
+	bool unity = false;
+	bool prescan = true;
+	bool stats = false;
+	bool reuse_pch = false;
+	bool single_file = false;
+	bool native = true;
+	std::filesystem::path compile_commands_name;
+	std::filesystem::path compile_units_name;
+	std::vector<std::filesystem::path> ast_names;
+	Frontend frontend = Frontend::Parse;
+	std::filesystem::path depfile_name;
+	std::filesystem::path manifest_name;
+	bool no_glue = false;
+	bool glue_only = false;
+	bool merge = false;
+	unsigned int shard_index = 0, shard_count = 0;
+	std::vector<std::filesystem::path> import_model_names;
+	std::filesystem::path export_model_name;
+	std::string overlay_name;
+	std::filesystem::path build_pch_name;
+	std::filesystem::path use_pch_name;
+
+	std::string current_option;
+
+	for (; argi < argc; argi++)
+	{
+		std::string args(argv[argi]);
+
+		if (current_option.empty())
+		{
+			if (args == "-include")
+				current_option = args;
+			else if (args == "-define")
+				current_option = args;
+			else if (args == "-out_extension")
+				current_option = args;
+			else if (args == "-glue_extension")
+				current_option = args;
+			else if (args == "-jobs")
+				current_option = args;
+			else if (args == "-depfile")
+				current_option = args;
+			else if (args == "-frontend")
+				current_option = args;
+			else if (args == "-compile_commands")
+				current_option = args;
+			else if (args == "-compile_units")
+				current_option = args;
+			else if (args == "-ast")
+				current_option = args;
+			else if (args == "-manifest")
+				current_option = args;
+			else if (args == "-import_model")
+				current_option = args;
+			else if (args == "-export_model")
+				current_option = args;
+			else if (args == "-overlay")
+				current_option = args;
+			else if (args == "-build_pch")
+				current_option = args;
+			else if (args == "-pch")
+				current_option = args;
+			else if (args == "-no_glue")
+				no_glue = true;
+			else if (args == "-glue_only")
+				glue_only = true;
+			else if (args == "-shard")
+				current_option = args;
+			else if (args == "-merge")
+				merge = true;
+			else if (args == "-reuse_pch")
+				reuse_pch = true;
+			else if (args == "-no_pch")
+				use_pch = false;
+			else if (args == "-watch")
+				watch = true;
+			else if (args == "-unity")
+				unity = true;
+			else if (args == "-no_prescan")
+				prescan = false;
+			else if (args == "-stats")
+				stats = true;
+			else if (args == "-single_file")
+				single_file = true;
+			else if (args == "-no_native")
+				native = false;
+			else
+				break;
+		}
+		else
+		{
+			if (current_option == "-include")
+			{
+				// Parse includes
+				auto arg_includes = ParseCMakeList(args);
+				in_includes.insert(in_includes.end(), arg_includes.begin(), arg_includes.end());
+			}
+			else if (current_option == "-define")
+			{
+				// Parse defines
+				auto arg_defines = ParseCMakeList(args);
+				in_defines.insert(in_defines.end(), arg_defines.begin(), arg_defines.end());
+			}
+			else if (current_option == "-out_extension")
+			{
+				out_extension = args;
+			}
+			else if (current_option == "-glue_extension")
+			{
+				glue_extension = args;
+			}
+			else if (current_option == "-depfile")
+			{
+				depfile_name = std::filesystem::path(args);
+			}
+			else if (current_option == "-manifest")
+			{
+				manifest_name = std::filesystem::path(args);
+			}
+			else if (current_option == "-shard")
+			{
+				// Shard i of n, counting from 0
+				size_t slash = args.find('/');
+				if (slash == std::string::npos)
+					throw std::runtime_error("Shard should be given as <i>/<n>: " + args);
+				shard_index = std::stoul(args.substr(0, slash));
+				shard_count = std::stoul(args.substr(slash + 1));
+				if (shard_count == 0 || shard_index >= shard_count)
+					throw std::runtime_error("Invalid shard: " + args);
+			}
+			else if (current_option == "-import_model")
+			{
+				// Models exported by the targets whose headers the sources include
+				for (auto &i : ParseCMakeList(args))
+					import_model_names.push_back(GetStdPath(i).path);
+			}
+			else if (current_option == "-export_model")
+			{
+				export_model_name = std::filesystem::path(args);
+			}
+			else if (current_option == "-build_pch")
+			{
+				// Only precompile the includes shared by the sources, for per source commands given -pch
+				build_pch_name = std::filesystem::path(args);
+			}
+			else if (current_option == "-pch")
+			{
+				// The shared includes precompiled by -build_pch
+				use_pch_name = std::filesystem::path(args);
+			}
+			else if (current_option == "-overlay")
+			{
+				// A file of overlay records, or - to read them from stdin
+				overlay_name = args;
+			}
+			else if (current_option == "-compile_commands")
+			{
+				compile_commands_name = std::filesystem::path(args);
+			}
+			else if (current_option == "-compile_units")
+			{
+				// The translation units of the target, only their commands are used
+				compile_units_name = std::filesystem::path(args);
+			}
+			else if (current_option == "-ast")
+			{
+				// ASTs the compiler serialized with -emit-ast or -emit-pch, defining _LEON_PROC
+				for (auto &i : ParseCMakeList(args))
+					ast_names.push_back(GetStdPath(i).path);
+			}
+			else if (current_option == "-frontend")
+			{
+				if (args == "parse")
+					frontend = Frontend::Parse;
+				else if (args == "index")
+					frontend = Frontend::Index;
+				else
+					throw std::runtime_error("Unknown frontend: " + args);
+			}
+			else if (current_option == "-jobs")
+			{
+				// 0 means use every hardware thread
+				jobs = std::stoul(args);
+				if (jobs == 0)
+					jobs = std::max(std::thread::hardware_concurrency(), 1U);
+			}
+			current_option.clear();
+		}
+	}
+
+	// Setup arguments
+	std::vector<std::unique_ptr<char[]>> args = Leon::Arguments::GetBase(in_includes, in_defines);
+
+	// A shard only generates its sources, the merge generates the glue from every shard's
+	if (shard_count != 0 && (glue_only || merge))
+		throw std::runtime_error("-shard can't be used with -glue_only or -merge");
+	if (shard_count != 0)
+		no_glue = true;
+	if (merge)
+		glue_only = true;
+
+	if (no_glue && glue_only)
+		throw std::runtime_error("-no_glue and -glue_only can't be used together");
+	if (watch && (no_glue || glue_only))
+		throw std::runtime_error("Watch mode can't be used with -no_glue, -glue_only, -shard or -merge");
+	if (!build_pch_name.empty() && (no_glue || glue_only || watch || unity || !use_pch || !use_pch_name.empty()))
+		throw std::runtime_error("-build_pch can't be used with -no_glue, -glue_only, -shard, -merge, -watch, -unity, -no_pch or -pch");
+
+	// Shards of a target can run at once, so each has its own manifest
+	if (manifest_name.empty())
+	{
+		if (shard_count != 0)
+			manifest_name = binary_dir / ("leon_manifest_shard" + std::to_string(shard_index) + ".txt");
+		else
+			manifest_name = binary_dir / "leon_manifest.txt";
+	}
+
+	// Load the rebuild manifest
+	// Outputs are only regenerated when the bytes of the Lua process, the arguments, or the sources and their includes change
+	// Commands running at the same time have to be given their own with -manifest
+	Leon::Manifest::Manifest manifest;
+	manifest.Load(manifest_name);
+
+	// Load the overlay
+	// Overlaid files are checked by their contents in memory, so it has to be loaded before anything is checked
+	// In watch mode, records piped to stdin are read as they arrive instead
+	Leon::Overlay::Overlay overlay;
+	bool watch_overlay = watch && overlay_name == "-";
+
+	if (overlay_name == "-")
+	{
+		if (batch.batched)
+			throw std::runtime_error("-overlay - can't be used in a batch");
+		if (!watch_overlay)
+			ReadOverlay(std::cin, overlay, manifest);
+	}
+	else if (!overlay_name.empty())
+	{
+		std::ifstream overlay_stream(overlay_name, std::ios::binary);
+		if (!overlay_stream)
+			throw std::runtime_error("Failed to open overlay: " + overlay_name);
+		ReadOverlay(overlay_stream, overlay, manifest);
+	}
+
+	std::stringstream lua_sstream;
+	{
+		std::ifstream lua_stream(lua_std.path);
+		lua_sstream << lua_stream.rdbuf();
+	}
+
+	Leon::Manifest::Hash script_hash = Leon::Manifest::HashString(lua_sstream.str());
+
+	// Load the compile commands
+	// The project's precompiled header replaces our own
+	std::vector<Leon::CompileCommands::Command> compile_commands;
+	std::vector<std::filesystem::path> compile_units;
+
+	if (!compile_commands_name.empty())
+		compile_commands = Leon::CompileCommands::Load(compile_commands_name);
+	if (!compile_units_name.empty())
+		compile_units = Leon::CompileCommands::LoadUnits(compile_units_name);
+	if (reuse_pch)
+		use_pch = false;
+
+	// Parse source arguments
+	std::vector<SourceArgument> source_args;
+	size_t source_i = 0;
+
+	for (; argi < argc; argi++)
+	{
+		auto sources = ParseCMakeList(std::string(argv[argi]));
+		for (auto &i : sources)
+		{
+			// Sources are dealt out to shards by their position, which is the same on every machine running the same command
+			if (shard_count != 0 && (source_i++ % shard_count) != shard_index)
+				continue;
+
+			// Get standard path of source file
+			SourceArgument source_arg;
+			source_arg.std = GetStdPath(i, overlay);
+			source_arg.overlaid = overlay.Find(source_arg.std.utf8) != nullptr;
+
+			// Get the binary path of the source file
+			std::filesystem::path in_path = source_arg.std.path;
+			CleanPath(in_path);
+
+			source_arg.binary_dir = binary_dir / in_path;
+			std::filesystem::create_directories(source_arg.binary_dir);
+
+			// Get the arguments to parse with
+			for (auto &a : args)
+				Leon::Arguments::Push(source_arg.args, a.get());
+
+			if (auto command = Leon::CompileCommands::Find(compile_commands, source_arg.std.path, compile_units))
+			{
+				// The compile commands provide the project's own language flags
+				// Precompiled headers our libclang can't load are dropped once we know we're parsing
+				auto flags = Leon::CompileCommands::GetParseFlags(*command, reuse_pch);
+				for (auto &f : flags)
+					Leon::Arguments::Push(source_arg.args, f);
+			}
+			else
+			{
+				Leon::Arguments::PushLanguage(source_arg.args);
+			}
+
+			source_arg.args_hash = Leon::Manifest::HashBytes(nullptr, 0);
+			for (auto &a : source_arg.args)
+				source_arg.args_hash = Leon::Manifest::HashString(a.get(), source_arg.args_hash);
+
+			// A source marked with LEON_SINGLE_FILE changes its own bytes, -single_file has to change the hash
+			source_arg.single_file = single_file;
+			if (single_file)
+				source_arg.args_hash = Leon::Manifest::HashString("-single_file", source_arg.args_hash);
+
+			// Check if we should rebuild the output file
+			source_arg.out_name = source_arg.binary_dir / ("out" + out_extension);
+			source_arg.depfile_name = source_arg.binary_dir / ("out" + out_extension + ".d");
+			source_arg.model_name = source_arg.binary_dir / "leon_model.txt";
+
+			// -glue_only and -build_pch leave the sources to their own commands
+			if (glue_only || !build_pch_name.empty())
+				source_arg.rebuild = false;
+			else if (!std::filesystem::exists(source_arg.out_name) || !std::filesystem::exists(source_arg.model_name))
+				source_arg.rebuild = true;
+			else if (!manifest.IsCurrent(source_arg.std.utf8, script_hash, source_arg.args_hash))
+				source_arg.rebuild = true;
+
+			source_args.emplace_back(std::move(source_arg));
+		}
+	}
+
+	if (source_args.size() == 0)
+	{
+		// More shards than sources leaves some with nothing to do
+		if (shard_count != 0)
+		{
+			std::cout << "[ Shard " << shard_index << "/" << shard_count << " has no sources ]" << '\n';
+			return 0;
+		}
+		throw std::runtime_error("Given no sources.");
+	}
+
+	if (shard_count != 0)
+		std::cout << "[ Shard " << shard_index << "/" << shard_count << " has " << source_args.size() << " of " << source_i << " source(s) ]" << '\n';
+
+	if (!build_pch_name.empty())
+	{
+		BuildSharedPrecompiledHeader(build_pch_name, depfile_name, source_args, prescan, manifest, manifest_name, overlay);
+		return 0;
+	}
+
+	// Every shard has to have generated its sources before they can be merged
+	if (merge)
+	{
+		for (auto &i : source_args)
+		{
+			if (!std::filesystem::exists(i.out_name) || !std::filesystem::exists(i.model_name))
+				throw std::runtime_error("Missing shard output for `" + i.std.utf8 + "`, run every shard into the binary directory before merging");
+		}
+	}
+
+	// Decide where to put the glue
+	std::filesystem::path glue_name = binary_dir / ("glue" + glue_extension);
+	Leon::Manifest::Hash sources_hash = GetSourcesHash(source_args);
+	bool rebuild_glue = false;
+
+	// -no_glue leaves the glue to its own command, so it isn't in the depfile either
+	std::filesystem::path depfile_glue_name = no_glue ? std::filesystem::path() : glue_name;
+
+	if (no_glue)
+		rebuild_glue = false;
+	else if (!std::filesystem::exists(glue_name))
+		rebuild_glue = true;
+	else if (!manifest.IsCurrent("glue", script_hash, sources_hash))
+		rebuild_glue = true;
+
+	// Nothing to do, finish before loading libclang or running any Lua
+	bool rebuild_any = rebuild_glue;
+	for (auto &i : source_args)
+		rebuild_any = rebuild_any || i.rebuild;
+
+	if (!rebuild_any && !watch)
+	{
+		if (no_glue)
+			std::cout << "[ " << source_args.size() << " source(s) up to date ]" << '\n';
+		else if (glue_only)
+			std::cout << "[ `glue` up to date ]" << '\n';
+		else
+			std::cout << "[ " << source_args.size() << " source(s) and `glue` up to date ]" << '\n';
+
+		// Sources may have been regenerated by their own commands, the export is only rewritten when their models changed
+		if (!export_model_name.empty())
+			ExportModel(export_model_name, source_args, manifest, false);
+		manifest.Save(manifest_name);
+		if (!depfile_name.empty() && !std::filesystem::exists(depfile_name))
+			WriteCommandDepfile(depfile_name, depfile_glue_name, lua_std, source_args);
+		if (batch.collect_dependencies)
+			GetCommandDependencies(depfile_glue_name, lua_std, source_args, batch.depfile_targets, batch.depfile_dependencies);
+
+		if (stats)
+			std::cout << "[ Up to date check took " << (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count() / 1000.0) << "ms ]" << '\n';
+		return 0;
+	}
+
+	batch.regenerated = true;
+
+	for (auto &i : source_args)
+		DropUnusablePrecompiledHeaders(i.args, batch.usable_pchs);
+
+	// Keep running and regenerate sources as they change
+	if (watch)
+	{
+		if (batch.batched)
+			throw std::runtime_error("Watch mode can't be used in a batch");
+
+		PrintClangVersion();
+		WatchSources(source_args, lua_std, glue_name, rebuild_glue, export_model_name, manifest, manifest_name, overlay, watch_overlay);
+		return 0;
+	}
+
+	// Skip parsing sources that can't contain any annotations, and find the ones marked to be parsed on their own
+	size_t num_skipped = 0;
+	for (auto &i : source_args)
+	{
+		// Overlaid sources aren't on disk to scan, so they're always parsed
+		if (!i.rebuild || i.overlaid)
+			continue;
+
+		auto scan = Leon::Prescan::Scan(i.std.path);
+		if (prescan && !scan.annotations)
+		{
+			i.parse = false;
+			num_skipped++;
+		}
+
+		if (scan.single_file)
+			i.single_file = true;
+		if (i.single_file)
+			i.single_file_args = GetSingleFileArgs(i.args);
+	}
+
+	// Parse what we can without libclang
+	// A source the native frontend can't fully handle is left for libclang, from scratch
+	std::vector<std::unique_ptr<SourceParse>> native_parses(source_args.size());
+	size_t num_native = 0;
+	if (native)
+	{
+		// Imported models let sources name what the headers of other targets reflected
+		Leon::Model::Model imports;
+		for (auto &i : import_model_names)
+		{
+			Leon::Model::Model model;
+			if (!model.Load(i))
+				throw std::runtime_error("Failed to load model: " + i.string());
+			imports.Merge(model);
+		}
+
+		for (size_t i = 0; i < source_args.size(); i++)
+		{
+			auto &source = source_args[i];
+			if (!source.rebuild || !source.parse || source.overlaid)
+				continue;
+
+			auto result = std::make_unique<SourceParse>();
+			auto start = std::chrono::steady_clock::now();
+			if (!Leon::Native::ParseSource(source.std.path, result->context, &imports))
+				continue;
+			result->parse_time = std::chrono::steady_clock::now() - start;
+
+			// Nothing outside of the source and the imported models went into the parse
+			result->dependencies.push_back(source.std.utf8);
+			for (auto &i : import_model_names)
+				result->dependencies.push_back(GetStdPath(i.string()).utf8);
+
+			native_parses[i] = std::move(result);
+			source.native = true;
+			num_native++;
+		}
+	}
+
+	for (auto &i : source_args)
+	{
+		if (i.rebuild && i.parse && !i.native)
+			PrintClangVersion();
+	}
+
+	// Precompile the includes shared by every source we're going to parse
+	// A unity parse only processes the shared includes once anyways
+	if (use_pch && !unity)
+	{
+		std::vector<SourceArgument *> pch_sources;
+		for (auto &i : source_args)
+		{
+			if (!i.rebuild || !i.parse || i.single_file || i.native || i.overlaid)
+				continue;
+			pch_sources.push_back(&i);
+		}
+
+		std::filesystem::path pch_name;
+		if (!use_pch_name.empty())
+		{
+			// Built by the target's -build_pch command, which leaves it empty when there's nothing to share
+			std::error_code ec;
+			auto pch_size = std::filesystem::file_size(use_pch_name, ec);
+			if (!ec && pch_size != 0)
+				pch_name = use_pch_name;
+		}
+		else if (pch_sources.size() > 1)
+		{
+			// A single source has nothing to share
+			auto pch_includes = GetSharedIncludes(pch_sources);
+			if (!pch_includes.empty())
+			{
+				// An earlier target of the batch may have precompiled the same includes with the same arguments
+				Leon::Manifest::Hash pch_hash = GetPrecompiledHeaderHash(pch_includes, *pch_sources[0], overlay);
+
+				auto cached_pch = batch.pchs.find(pch_hash);
+				if (cached_pch != batch.pchs.end())
+				{
+					std::cout << "[ Reusing " << pch_includes.size() << " precompiled shared include(s) ]" << '\n';
+					pch_name = cached_pch->second;
+				}
+				else
+				{
+					std::cout << "[ Precompiling " << pch_includes.size() << " shared include(s) ]" << '\n';
+
+					if (BuildPrecompiledHeader(binary_dir / "leon_pch.pch", pch_includes, pch_sources[0]->args, overlay))
+					{
+						pch_name = binary_dir / "leon_pch.pch";
+						batch.pchs.emplace(pch_hash, pch_name);
+					}
+					else
+					{
+						std::cout << "[ Failed to precompile shared includes, parsing without ]" << '\n';
+					}
+				}
+			}
+		}
+
+		if (!pch_name.empty())
+		{
+			for (auto i : pch_sources)
+			{
+				Leon::Arguments::Push(i->args, "-include-pch");
+				Leon::Arguments::Push(i->args, pch_name.string());
+			}
+		}
+	}
+
+	// Start parsing sources
+	ParsePool parse_pool(batch, source_args, overlay, std::move(native_parses), jobs, frontend, unity ? (binary_dir / "leon_unity.cpp") : std::filesystem::path(), ast_names, stats);
+
+	// Load and compile lua source, unless an earlier target of the batch already did
+	Leon::Process::Script &script = batch.GetScript(script_hash, lua_sstream.str());
+
+	// Process sources
+	std::chrono::steady_clock::duration total_parse_time = {};
+	std::chrono::steady_clock::duration single_file_time = {}, full_parse_time = {};
+
+	for (size_t source_i = 0; source_i < source_args.size(); source_i++)
+	{
+		auto &source = source_args[source_i];
+
+		// Get shorthand name
+		std::string short_name = source.std.path.filename().string();
+
+		if (!source.rebuild)
+		{
+			if (!glue_only)
+				std::cout << "[ `" << short_name << "` up to date ]" << '\n';
+			continue;
+		}
+		else
+		{
+			std::cout << "[ Generating `" << short_name << "` ]" << '\n';
+		}
+
+		// Get parse from libclang
+		std::unique_ptr<SourceParse> parse = parse_pool.Take(source_i);
+
+		if (!parse->diagnostics.empty())
+		{
+			std::cout << std::flush;
+			std::cerr << parse->diagnostics << std::flush;
+		}
+		if (parse->error)
+			std::rethrow_exception(parse->error);
+
+		total_parse_time += parse->parse_time;
+		if (stats)
+		{
+			auto parse_ms = std::chrono::duration_cast<std::chrono::milliseconds>(parse->parse_time).count();
+			if (source.native)
+				std::cout << "[ `" << short_name << "` parsed without libclang in " << parse_ms << "ms ]" << '\n';
+			else
+				std::cout << "[ `" << short_name << "` parsed in " << parse_ms << "ms, visited " << parse->context.cursor_visits << " cursor(s) ]" << '\n';
+
+			if (parse->full_parse_time.count() != 0)
+			{
+				auto full_ms = std::chrono::duration_cast<std::chrono::milliseconds>(parse->full_parse_time).count();
+				std::cout << "[ `" << short_name << "` parsed as a single file, a full parse takes " << full_ms << "ms ]" << '\n';
+
+				single_file_time += parse->parse_time;
+				full_parse_time += parse->full_parse_time;
+			}
+
+			// Model allocations, as requested by the registries and as served by the arena
+			auto &arena = parse->context.arena;
+			auto &arena_blocks = parse->context.arena_blocks;
+			std::cout << "[ `" << short_name << "` model made " << arena.allocations << " allocation(s) of " << arena.bytes << " bytes (peak " << arena.peak_bytes << "), arena made " << arena_blocks.allocations << " allocation(s) of " << arena_blocks.bytes << " bytes ]" << '\n';
+		}
+
+		// Process in Lua process
+		WriteOutput(source.out_name, script.SourceProcess(source.std.utf8, parse->context));
+		Leon::Depend::WriteDepfile(source.depfile_name, { source.out_name.string() }, parse->dependencies);
+		if (WriteSourceModel(source.model_name, parse->context) && !no_glue)
+			rebuild_glue = true;
+
+		manifest.Update(source.std.utf8, script_hash, source.args_hash, parse->dependencies);
+	}
+
+	if (num_skipped != 0)
+		std::cout << "[ Skipped parsing " << num_skipped << " source(s) without annotations ]" << '\n';
+	if (num_native != 0)
+		std::cout << "[ Parsed " << num_native << " source(s) without libclang ]" << '\n';
+	if (stats)
+	{
+		std::cout << "[ Parsing took " << std::chrono::duration_cast<std::chrono::milliseconds>(total_parse_time).count() << "ms ]" << '\n';
+
+		if (full_parse_time.count() != 0)
+		{
+			auto single_file_us = std::chrono::duration_cast<std::chrono::microseconds>(single_file_time).count();
+			auto full_us = std::chrono::duration_cast<std::chrono::microseconds>(full_parse_time).count();
+			std::cout << "[ Single file parsing took " << (single_file_us / 1000) << "ms instead of " << (full_us / 1000) << "ms, " << (static_cast<double>(full_us) / std::max<long long>(single_file_us, 1)) << "x faster ]" << '\n';
+		}
+	}
+
+	// Generate glue
+	if (!rebuild_glue)
+	{
+		if (!no_glue)
+			std::cout << "[ `glue` up to date ]" << '\n';
+	}
+	else
+	{
+		std::cout << "[ Generating `glue` ]" << '\n';
+		WriteOutput(glue_name, script.GlueProcess(GetGlueSources(source_args), GetTargetModel(source_args)));
+
+		manifest.Update("glue", script_hash, sources_hash, GetSourceModelNames(source_args));
+	}
+
+	// Export the model of every source
+	if (!export_model_name.empty())
+	{
+		bool rebuilt_source = false;
+		for (auto &i : source_args)
+			rebuilt_source = rebuilt_source || i.rebuild;
+		ExportModel(export_model_name, source_args, manifest, rebuilt_source);
+	}
+
+	manifest.Save(manifest_name);
+
+	// Write the depfile for the whole command
+	if (!depfile_name.empty())
+		WriteCommandDepfile(depfile_name, depfile_glue_name, lua_std, source_args);
+	if (batch.collect_dependencies)
+		GetCommandDependencies(depfile_glue_name, lua_std, source_args, batch.depfile_targets, batch.depfile_dependencies);
+
+	return 0;
+}
+
+// Run every target of a batch file
+// Each target's arguments are listed one per line, as they'd be passed on the command line, and end with a `--` line
+static int RunBatch(const char *program, const std::filesystem::path &batch_name, const std::filesystem::path &depfile_name, Batch &batch)
+{
+	std::ifstream batch_stream(batch_name, std::ios::binary);
+	if (!batch_stream)
+		throw std::runtime_error("Failed to open batch: " + batch_name.string());
+
+	batch.batched = true;
+	batch.collect_dependencies = !depfile_name.empty();
+
+	std::vector<std::string> target_args;
+	auto run_target = [&]() -> int
+		{
+			std::vector<char *> argv = { const_cast<char *>(program) };
+			for (auto &i : target_args)
+				argv.push_back(i.data());
+
+			int result = RunTarget(static_cast<int>(argv.size()), argv.data(), batch);
+			target_args.clear();
+			return result;
+		};
+
+	size_t num_targets = 0;
+	std::string line;
+	while (std::getline(batch_stream, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line != "--")
+		{
+			target_args.push_back(line);
+			continue;
+		}
+
+		num_targets++;
+		if (int result = run_target())
+			return result;
+	}
+
+	if (!target_args.empty())
+	{
+		num_targets++;
+		if (int result = run_target())
+			return result;
+	}
+
+	std::cout << "[ Ran " << num_targets << " target(s) ]" << '\n';
+
+	// The batch's depfile only changes when a target regenerated something
+	if (!depfile_name.empty() && (batch.regenerated || !std::filesystem::exists(depfile_name)))
+		Leon::Depend::WriteDepfile(depfile_name, batch.depfile_targets, batch.depfile_dependencies);
+
+	return 0;
+}
+
+// Entry point
+int main(int argc, char **argv)
+{
+	try
+	{
+		// Print Leon information
+		// libclang isn't touched until something needs parsing, so a run with nothing to do stays cheap
+		std::cout << "========================================" << '\n';
+		std::cout << "Leon (" LEON_VERSION ")" << '\n';
+		std::cout << "========================================" << std::endl;
+
+		Batch batch;
+
+		// Run every target of a batch file
+		if (argc >= 3 && std::string(argv[1]) == "-batch")
+		{
+			std::filesystem::path depfile_name;
+			if (argc >= 5 && std::string(argv[3]) == "-depfile")
+				depfile_name = std::filesystem::u8path(argv[4]);
+			return RunBatch(argv[0], std::filesystem::u8path(argv[2]), depfile_name, batch);
+		}
+
+		return RunTarget(argc, argv, batch);
 	}
 	catch (std::exception &e)
 	{
@@ -0,0 +1,307 @@
+/*
+ * [ Leon ]
+ *   Source/Manifest.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Manifest.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace Leon
+{
+namespace Manifest
+{
+
+// Content hashes
+// 64-bit FNV-1a, this isn't cryptographic, it only has to notice edits
+Hash HashBytes(const void *data, size_t size, Hash hash)
+{
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+Hash HashString(const std::string &string, Hash hash)
+{
+	// Include the terminator so that lists of strings hash unambiguously
+	return HashBytes(string.c_str(), string.size() + 1, hash);
+}
+
+bool HashFile(const std::filesystem::path &path, Hash &hash)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+		return false;
+
+	hash = HashBytes(nullptr, 0);
+
+	char buffer[0x10000];
+	while (stream)
+	{
+		stream.read(buffer, sizeof(buffer));
+		hash = HashBytes(buffer, static_cast<size_t>(stream.gcount()), hash);
+	}
+
+	return true;
+}
+
+// Get the size and write time of a file
+static bool StatFile(const std::filesystem::path &path, uint64_t &size, int64_t &write_time)
+{
+	std::error_code ec;
+	size = std::filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+	write_time = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+	if (ec)
+		return false;
+	return true;
+}
+
+// Rebuild manifest
+void Manifest::Load(const std::filesystem::path &path)
+{
+	entries.clear();
+	modified = false;
+
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+		return;
+
+	std::string line;
+	if (!std::getline(stream, line) || line != "leon-manifest 1")
+		return;
+
+	Entry *entry = nullptr;
+
+	while (std::getline(stream, line))
+	{
+		std::stringstream line_stream(line);
+
+		std::string token;
+		line_stream >> token;
+
+		// Paths are always last, as they may contain spaces
+		auto read_path = [&line_stream]() -> std::string
+			{
+				std::string path;
+				line_stream.get();
+				std::getline(line_stream, path);
+				return path;
+			};
+
+		if (token == "source")
+		{
+			entry = &entries[read_path()];
+		}
+		else if (entry == nullptr)
+		{
+			break;
+		}
+		else if (token == "script")
+		{
+			line_stream >> std::hex >> entry->script;
+		}
+		else if (token == "args")
+		{
+			line_stream >> std::hex >> entry->args;
+		}
+		else if (token == "file")
+		{
+			File file;
+			line_stream >> std::hex >> file.hash >> std::dec >> file.size >> file.write_time;
+			file.path = read_path();
+			entry->files.emplace_back(std::move(file));
+		}
+	}
+}
+
+void Manifest::Save(const std::filesystem::path &path)
+{
+	if (!modified)
+		return;
+
+	// Write to a temporary file first, so an interrupted write doesn't leave a broken manifest
+	std::filesystem::path temp_path = path;
+	temp_path += ".tmp";
+	{
+		std::ofstream stream(temp_path, std::ios::binary);
+		if (!stream)
+			throw std::runtime_error("Failed to open manifest: " + temp_path.string());
+
+		stream << "leon-manifest 1\n";
+		for (auto &i : entries)
+		{
+			stream << "source " << i.first << '\n';
+			stream << "script " << std::hex << i.second.script << '\n';
+			stream << "args " << std::hex << i.second.args << '\n';
+			for (auto &f : i.second.files)
+				stream << "file " << std::hex << f.hash << ' ' << std::dec << f.size << ' ' << f.write_time << ' ' << f.path << '\n';
+		}
+	}
+
+	std::filesystem::rename(temp_path, path);
+	modified = false;
+}
+
+bool Manifest::IsCurrent(const std::string &key, Hash script, Hash args)
+{
+	auto it = entries.find(key);
+	if (it == entries.end())
+		return false;
+
+	auto &entry = it->second;
+	if (entry.script != script || entry.args != args)
+		return false;
+
+	for (auto &f : entry.files)
+	{
+		// Files in memory are only compared by their contents
+		auto overridden = overridden_files.find(f.path);
+		if (overridden != overridden_files.end())
+		{
+			if (overridden->second.size != f.size || overridden->second.hash != f.hash)
+				return false;
+			continue;
+		}
+
+		// A file that was missing is current for as long as it stays missing
+		// Other entries may have recorded the file as it was on disk, so this isn't cached
+		if (f.write_time == MissingWriteTime)
+		{
+			uint64_t size;
+			int64_t write_time;
+			if (StatFile(std::filesystem::path(f.path), size, write_time))
+				return false;
+			continue;
+		}
+
+		// Check if this file was already found current for another entry
+		auto checked = checked_files.find(f.path);
+		if (checked != checked_files.end())
+		{
+			if (!checked->second)
+				return false;
+			continue;
+		}
+
+		uint64_t size;
+		int64_t write_time;
+		bool current = StatFile(std::filesystem::path(f.path), size, write_time);
+
+		if (current && (size != f.size || write_time != f.write_time))
+		{
+			// Matching stats mean the file wasn't touched, otherwise only the contents matter
+			Hash hash;
+			current = size == f.size && HashFile(std::filesystem::path(f.path), hash) && hash == f.hash;
+			if (current)
+			{
+				f.write_time = write_time;
+				modified = true;
+			}
+		}
+
+		checked_files[f.path] = current;
+		if (!current)
+			return false;
+	}
+
+	return true;
+}
+
+void Manifest::Update(const std::string &key, Hash script, Hash args, const std::vector<std::string> &files)
+{
+	Entry entry;
+	entry.script = script;
+	entry.args = args;
+
+	for (auto &i : files)
+	{
+		auto overridden = overridden_files.find(i);
+		if (overridden != overridden_files.end())
+		{
+			entry.files.push_back(overridden->second);
+			continue;
+		}
+
+		File file;
+		file.path = i;
+		if (!StatFile(std::filesystem::path(file.path), file.size, file.write_time))
+		{
+			file.size = 0;
+			file.write_time = MissingWriteTime;
+			entry.files.emplace_back(std::move(file));
+			continue;
+		}
+
+		// Reuse the hash if the file wasn't touched since it was last hashed
+		auto hashed = hashed_files.find(i);
+		if (hashed != hashed_files.end() && hashed->second.size == file.size && hashed->second.write_time == file.write_time)
+		{
+			entry.files.push_back(hashed->second);
+			continue;
+		}
+
+		if (!HashFile(std::filesystem::path(file.path), file.hash))
+		{
+			file.size = 0;
+			file.write_time = MissingWriteTime;
+			file.hash = 0;
+			entry.files.emplace_back(std::move(file));
+			continue;
+		}
+
+		hashed_files[i] = file;
+		entry.files.emplace_back(std::move(file));
+	}
+
+	entries[key] = std::move(entry);
+	modified = true;
+}
+
+void Manifest::Remove(const std::string &key)
+{
+	if (entries.erase(key))
+		modified = true;
+}
+
+void Manifest::Override(const std::string &path, const std::string &contents)
+{
+	// There's no write time, so once the file is back on disk it's always rehashed
+	File file;
+	file.path = path;
+	file.size = contents.size();
+	file.write_time = 0;
+	file.hash = HashBytes(contents.data(), contents.size());
+
+	overridden_files[path] = file;
+	checked_files.erase(path);
+	hashed_files.erase(path);
+}
+
+}
+}
@@ -0,0 +1,103 @@
+/*
+ * [ Leon ]
+ *   Source/Manifest.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Leon
+{
+namespace Manifest
+{
+
+// Content hashes
+typedef uint64_t Hash;
+
+Hash HashBytes(const void *data, size_t size, Hash hash = 0xCBF29CE484222325ULL);
+Hash HashString(const std::string &string, Hash hash = 0xCBF29CE484222325ULL);
+
+// Hash the contents of a file
+// Returns false if the file couldn't be read
+bool HashFile(const std::filesystem::path &path, Hash &hash);
+
+// Rebuild manifest
+// Records the content hashes an output was generated from, so outputs are only regenerated when bytes actually change.
+// File sizes and write times are recorded too, so unchanged files don't have to be rehashed.
+class Manifest
+{
+	private:
+		// A file that couldn't be read is still recorded, so the entry goes out of date once it can be
+		static constexpr int64_t MissingWriteTime = -1;
+
+		struct File
+		{
+			std::string path;
+			uint64_t size = 0;
+			int64_t write_time = 0;
+			Hash hash = 0;
+		};
+
+		struct Entry
+		{
+			Hash script = 0;
+			Hash args = 0;
+			std::vector<File> files;
+		};
+
+		std::unordered_map<std::string, Entry> entries;
+		bool modified = false;
+
+		// Files are often shared between entries, so only check and hash them once per run
+		std::unordered_map<std::string, bool> checked_files;
+		std::unordered_map<std::string, File> hashed_files;
+
+		// Files whose contents are given in memory, by path
+		std::unordered_map<std::string, File> overridden_files;
+
+	public:
+		// Load a manifest
+		// A missing or unreadable manifest is treated as empty
+		void Load(const std::filesystem::path &path);
+
+		// Save the manifest if it was modified
+		void Save(const std::filesystem::path &path);
+
+		// Check if an output is current
+		bool IsCurrent(const std::string &key, Hash script, Hash args);
+
+		// Record the files an output was generated from
+		void Update(const std::string &key, Hash script, Hash args, const std::vector<std::string> &files);
+
+		// Forget an output, forcing it to be regenerated
+		void Remove(const std::string &key);
+
+		// Give the contents of a file that's held in memory instead of on disk
+		// The file is checked and recorded by the hash of these contents, whatever is on disk
+		void Override(const std::string &path, const std::string &contents);
+};
+
+}
+}
@@ -0,0 +1,226 @@
+/*
+ * [ Leon ]
+ *   Source/Model.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Model.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace Leon
+{
+namespace Model
+{
+
+// Reflection model
+void Model::Add(const Leon::Parse::Context &context)
+{
+	for (auto &i : context.class_nodes)
+	{
+		// Opaque declarations of a lenient parse can't be identified
+		if (i.second.usr.empty())
+			continue;
+
+		Declaration declaration;
+		declaration.name = i.first;
+		if (i.second.is_template)
+			declaration.kind = Declaration::Kind::ClassTemplate;
+		else if (i.second.class_type == Leon::Parse::ClassNode::ClassType::Struct)
+			declaration.kind = Declaration::Kind::Struct;
+		else
+			declaration.kind = Declaration::Kind::Class;
+		declaration.q_abstract = i.second.q_abstract;
+
+		declarations[std::string(i.second.usr)] = std::move(declaration);
+	}
+
+	for (auto &i : context.enum_nodes)
+	{
+		if (i.second.usr.empty())
+			continue;
+
+		Declaration declaration;
+		declaration.name = i.first;
+		declaration.kind = Declaration::Kind::Enum;
+
+		declarations[std::string(i.second.usr)] = std::move(declaration);
+	}
+
+	// Only unqualified types, their variants name the same declaration
+	for (auto &i : context.types)
+	{
+		if (i.usr.empty() || i.unqualified_root != i.id)
+			continue;
+
+		Declaration declaration;
+		declaration.name = i.name;
+		declaration.kind = Declaration::Kind::Type;
+
+		declarations.emplace(std::string(i.usr), std::move(declaration));
+	}
+}
+
+void Model::Merge(const Model &other, const std::string &source)
+{
+	for (auto &i : other.declarations)
+	{
+		auto it = declarations.find(i.first);
+		if (it == declarations.end())
+		{
+			it = declarations.emplace(i.first, i.second).first;
+		}
+		else if (it->second.kind == Declaration::Kind::Type && i.second.kind != Declaration::Kind::Type)
+		{
+			std::vector<std::string> references = std::move(it->second.references);
+			it->second = i.second;
+			it->second.references = std::move(references);
+		}
+
+		if (!source.empty())
+		{
+			if (i.second.kind != Declaration::Kind::Type && it->second.source.empty())
+				it->second.source = source;
+			it->second.references.push_back(source);
+		}
+	}
+}
+
+bool Model::Load(const std::filesystem::path &path)
+{
+	declarations.clear();
+
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+		return false;
+
+	std::string line;
+	if (!std::getline(stream, line) || line != "leon-model 2")
+		return false;
+
+	std::string usr;
+
+	while (std::getline(stream, line))
+	{
+		std::stringstream line_stream(line);
+
+		std::string token;
+		line_stream >> token;
+
+		// Names and USRs are always last, as they may contain spaces
+		auto read_name = [&line_stream]() -> std::string
+			{
+				std::string name;
+				line_stream.get();
+				std::getline(line_stream, name);
+				return name;
+			};
+
+		// Each declaration follows its USR
+		if (token == "usr")
+		{
+			usr = read_name();
+			continue;
+		}
+		if (usr.empty())
+			return false;
+
+		int q_abstract = 0;
+		line_stream >> q_abstract;
+
+		Declaration declaration;
+		if (token == "struct")
+			declaration.kind = Declaration::Kind::Struct;
+		else if (token == "class")
+			declaration.kind = Declaration::Kind::Class;
+		else if (token == "template")
+			declaration.kind = Declaration::Kind::ClassTemplate;
+		else if (token == "enum")
+			declaration.kind = Declaration::Kind::Enum;
+		else if (token == "type")
+			declaration.kind = Declaration::Kind::Type;
+		else
+			return false;
+		declaration.q_abstract = q_abstract != 0;
+
+		declaration.name = read_name();
+		if (declaration.name.empty())
+			return false;
+
+		declarations[usr] = std::move(declaration);
+		usr.clear();
+	}
+
+	return true;
+}
+
+bool Model::Save(const std::filesystem::path &path) const
+{
+	std::stringstream model_stream;
+	model_stream << "leon-model 2\n";
+	for (auto &i : declarations)
+	{
+		model_stream << "usr " << i.first << '\n';
+		switch (i.second.kind)
+		{
+			case Declaration::Kind::Struct:
+				model_stream << "struct";
+				break;
+			case Declaration::Kind::Class:
+				model_stream << "class";
+				break;
+			case Declaration::Kind::ClassTemplate:
+				model_stream << "template";
+				break;
+			case Declaration::Kind::Enum:
+				model_stream << "enum";
+				break;
+			case Declaration::Kind::Type:
+				model_stream << "type";
+				break;
+			default:
+				throw std::runtime_error("Invalid declaration in model: " + i.first);
+		}
+		model_stream << ' ' << (i.second.q_abstract ? 1 : 0) << ' ' << i.second.name << '\n';
+	}
+	std::string model = model_stream.str();
+
+	// Compare with what's already there
+	{
+		std::ifstream stream(path, std::ios::binary);
+		if (stream)
+		{
+			std::stringstream sstream;
+			sstream << stream.rdbuf();
+			if (sstream.str() == model)
+				return false;
+		}
+	}
+
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream)
+		throw std::runtime_error("Failed to open model: " + path.string());
+	stream.write(model.data(), model.size());
+	return true;
+}
+
+}
+}
@@ -0,0 +1,87 @@
+/*
+ * [ Leon ]
+ *   Source/Model.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Parse.h"
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Leon
+{
+namespace Model
+{
+
+// Declaration
+struct Declaration
+{
+	enum class Kind
+	{
+		Invalid,
+		Struct,
+		Class,
+		ClassTemplate,
+		Enum,
+		Type, // Class or enum that's only referenced, it's reflected elsewhere or not at all
+	} kind = Kind::Invalid;
+
+	std::string name;
+	bool q_abstract = false;
+
+	// Source that reflected the declaration, and every source referencing it
+	// Only filled when merging source models, and not saved
+	std::string source;
+	std::vector<std::string> references;
+};
+
+// Reflection model
+// The classes and enums sources reflected or referenced, each recorded once by its clang USR, no matter how many sources include it.
+// Targets including the same headers can resolve them without parsing those headers again, and GlueProcess gets every declaration once.
+// Declarations are sorted, so the same declarations always save to the same bytes.
+class Model
+{
+	public:
+		std::map<std::string, Declaration> declarations;
+
+		// Add the classes and enums registered in a context, and the ones its types name
+		void Add(const Leon::Parse::Context &context);
+
+		// Add the declarations of another model
+		// A reflected declaration replaces one that's only referenced
+		// Given the source the model is of, it's recorded as referencing each declaration
+		void Merge(const Model &other, const std::string &source = "");
+
+		// Load a model
+		// Returns false if the model is missing or unreadable
+		bool Load(const std::filesystem::path &path);
+
+		// Save the model
+		// Leaves the file untouched if it already holds the same model, so whatever depends on it isn't rerun
+		// Returns whether the file was written
+		bool Save(const std::filesystem::path &path) const;
+};
+
+}
+}
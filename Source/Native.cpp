@@ -0,0 +1,1389 @@
+/*
+ * [ Leon ]
+ *   Source/Native.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Native.h"
+
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Leon
+{
+namespace Native
+{
+
+// Thrown when the source uses something the native parser doesn't handle
+class Unsupported : public std::runtime_error
+{
+	public:
+		Unsupported(const std::string &what) : std::runtime_error(what) {}
+};
+
+// Token
+struct Token
+{
+	enum class Type
+	{
+		End,
+		Identifier,
+		Number,
+		String,
+		Punctuation,
+	} type = Type::End;
+
+	std::string_view text;
+	bool space_before = false;
+};
+
+// Character classes
+static bool IsIdentStart(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool IsIdent(char c)
+{
+	return IsIdentStart(c) || (c >= '0' && c <= '9');
+}
+
+static bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+// Check a preprocessor directive
+// Only #pragma once and #include are understood, anything else could change what the source means
+static void CheckDirective(std::string_view line)
+{
+	if (line.find("/*") != std::string_view::npos)
+		throw Unsupported("Comment in directive");
+
+	size_t comment = line.find("//");
+	if (comment != std::string_view::npos)
+		line = line.substr(0, comment);
+
+	auto trim = [](std::string_view str) -> std::string_view
+		{
+			while (!str.empty() && IsSpace(str.front()))
+				str.remove_prefix(1);
+			while (!str.empty() && IsSpace(str.back()))
+				str.remove_suffix(1);
+			return str;
+		};
+
+	line = trim(line);
+	if (line.empty())
+		return;
+
+	size_t word_end = 0;
+	while (word_end < line.size() && IsIdent(line[word_end]))
+		word_end++;
+
+	std::string_view directive = line.substr(0, word_end);
+	std::string_view rest = trim(line.substr(word_end));
+
+	if (directive == "pragma" && rest == "once")
+		return;
+	if (directive == "include" && rest.size() >= 2 && ((rest.front() == '<' && rest.back() == '>') || (rest.front() == '"' && rest.back() == '"')))
+		return;
+
+	throw Unsupported("Preprocessor directive: " + std::string(line));
+}
+
+// Split a source into tokens
+static std::vector<Token> Tokenize(std::string_view src)
+{
+	std::vector<Token> tokens;
+
+	size_t i = 0;
+	size_t n = src.size();
+	bool space = false;
+	bool line_start = true;
+
+	while (i < n)
+	{
+		char c = src[i];
+
+		if (c == '\\')
+			throw Unsupported("Line continuation");
+
+		if (IsSpace(c))
+		{
+			if (c == '\n')
+				line_start = true;
+			space = true;
+			i++;
+			continue;
+		}
+
+		if (c == '/' && i + 1 < n && src[i + 1] == '/')
+		{
+			// Line comment, a trailing backslash would continue it
+			size_t end = src.find('\n', i);
+			if (end == std::string_view::npos)
+				end = n;
+			if (src.substr(i, end - i).find('\\') != std::string_view::npos)
+				throw Unsupported("Backslash in comment");
+
+			i = end;
+			space = true;
+			continue;
+		}
+
+		if (c == '/' && i + 1 < n && src[i + 1] == '*')
+		{
+			// Block comment
+			size_t end = src.find("*/", i + 2);
+			if (end == std::string_view::npos)
+				throw Unsupported("Unterminated comment");
+
+			i = end + 2;
+			space = true;
+			continue;
+		}
+
+		if (c == '#' && line_start)
+		{
+			// Preprocessor directive
+			size_t end = src.find('\n', i);
+			if (end == std::string_view::npos)
+				end = n;
+
+			CheckDirective(src.substr(i + 1, end - i - 1));
+			i = end;
+			continue;
+		}
+
+		line_start = false;
+
+		Token token;
+		token.space_before = space;
+		space = false;
+
+		size_t start = i;
+		if (IsIdentStart(c))
+		{
+			while (i < n && IsIdent(src[i]))
+				i++;
+			token.type = Token::Type::Identifier;
+
+			// Prefixed literals, like u8"" or R"()"
+			if (i < n && (src[i] == '"' || src[i] == '\''))
+				throw Unsupported("Prefixed literal");
+		}
+		else if (c >= '0' && c <= '9')
+		{
+			// Numbers may contain ' digit separators and exponent signs
+			i++;
+			while (i < n)
+			{
+				char d = src[i];
+				if ((d == '+' || d == '-') && (src[i - 1] == 'e' || src[i - 1] == 'E' || src[i - 1] == 'p' || src[i - 1] == 'P'))
+					i++;
+				else if (IsIdent(d) || d == '.' || d == '\'')
+					i++;
+				else
+					break;
+			}
+			token.type = Token::Type::Number;
+		}
+		else if (c == '"')
+		{
+			i++;
+			while (1)
+			{
+				if (i >= n || src[i] == '\n')
+					throw Unsupported("Unterminated string");
+				if (src[i] == '\\')
+					i += 2;
+				else if (src[i++] == '"')
+					break;
+			}
+			token.type = Token::Type::String;
+		}
+		else if (c == '\'')
+		{
+			throw Unsupported("Character literal");
+		}
+		else if (static_cast<unsigned char>(c) >= 0x80)
+		{
+			throw Unsupported("Non-ASCII character");
+		}
+		else if (c == ':' && i + 1 < n && src[i + 1] == ':')
+		{
+			i += 2;
+			token.type = Token::Type::Punctuation;
+		}
+		else
+		{
+			i++;
+			token.type = Token::Type::Punctuation;
+		}
+
+		token.text = src.substr(start, i - start);
+		tokens.push_back(token);
+	}
+
+	tokens.emplace_back();
+	return tokens;
+}
+
+// Builtin type specifiers, which can be written in any order
+struct BuiltinType
+{
+	int sign = 0; // -1 for signed, 1 for unsigned
+	int num_short = 0, num_long = 0, num_int = 0;
+	std::string_view base;
+
+	// Add a specifier, returns false if the word isn't one
+	bool Add(std::string_view word)
+	{
+		if (word == "signed" || word == "unsigned")
+		{
+			if (sign != 0)
+				throw Unsupported("Repeated sign");
+			sign = (word == "signed") ? -1 : 1;
+		}
+		else if (word == "short")
+		{
+			num_short++;
+		}
+		else if (word == "long")
+		{
+			num_long++;
+		}
+		else if (word == "int")
+		{
+			num_int++;
+		}
+		else if (word == "char" || word == "bool" || word == "float" || word == "double" || word == "wchar_t" || word == "char8_t" || word == "char16_t" || word == "char32_t")
+		{
+			if (!base.empty())
+				throw Unsupported("Repeated type");
+			base = word;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	bool Empty() const
+	{
+		return sign == 0 && num_short == 0 && num_long == 0 && num_int == 0 && base.empty();
+	}
+
+	// Get the name clang spells the type with
+	std::string Name() const
+	{
+		if (Empty())
+			throw Unsupported("No type");
+
+		if (base == "char")
+		{
+			if (num_short != 0 || num_long != 0 || num_int != 0)
+				throw Unsupported("Invalid char type");
+			return (sign < 0) ? "signed char" : (sign > 0) ? "unsigned char" : "char";
+		}
+
+		if (base == "double")
+		{
+			if (sign != 0 || num_short != 0 || num_int != 0 || num_long > 1)
+				throw Unsupported("Invalid double type");
+			return (num_long != 0) ? "long double" : "double";
+		}
+
+		if (!base.empty())
+		{
+			if (sign != 0 || num_short != 0 || num_long != 0 || num_int != 0)
+				throw Unsupported("Invalid " + std::string(base) + " type");
+			return std::string(base);
+		}
+
+		if (num_int > 1 || num_short > 1 || num_long > 2 || (num_short != 0 && num_long != 0))
+			throw Unsupported("Invalid integer type");
+
+		std::string name = (sign > 0) ? "unsigned " : "";
+		if (num_short != 0)
+			return name + "short";
+		if (num_long == 1)
+			return name + "long";
+		if (num_long == 2)
+			return name + "long long";
+		return name + "int";
+	}
+};
+
+// Parse an integer literal
+// Unsigned literals are left to libclang, as is anything outside of int
+static long long ParseInteger(std::string_view text)
+{
+	std::string digits;
+	for (char c : text)
+		if (c != '\'')
+			digits += c;
+
+	// Only long suffixes, which don't change the value
+	while (!digits.empty() && (digits.back() == 'l' || digits.back() == 'L'))
+		digits.pop_back();
+
+	int base = 10;
+	size_t start = 0;
+	if (digits.size() > 1 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X'))
+	{
+		base = 16;
+		start = 2;
+	}
+	else if (digits.size() > 1 && digits[0] == '0' && (digits[1] == 'b' || digits[1] == 'B'))
+	{
+		base = 2;
+		start = 2;
+	}
+	else if (digits.size() > 1 && digits[0] == '0')
+	{
+		base = 8;
+		start = 1;
+	}
+
+	if (start >= digits.size())
+		throw Unsupported("Invalid integer: " + std::string(text));
+
+	long long value = 0;
+	for (size_t i = start; i < digits.size(); i++)
+	{
+		char c = digits[i];
+		int digit;
+		if (c >= '0' && c <= '9')
+			digit = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			digit = c - 'A' + 10;
+		else
+			throw Unsupported("Invalid integer: " + std::string(text));
+
+		if (digit >= base)
+			throw Unsupported("Invalid integer: " + std::string(text));
+
+		value = value * base + digit;
+		if (value > INT_MAX)
+			throw Unsupported("Integer out of range: " + std::string(text));
+	}
+
+	return value;
+}
+
+// Declaration parser
+class Parser
+{
+	private:
+		Leon::Parse::Context &context;
+
+		std::vector<Token> tokens;
+		size_t pos = 0;
+
+		// Enclosing scopes, by full name
+		struct Scope
+		{
+			std::string name;
+			bool is_namespace = false;
+
+			// USR prefix of the declarations in the scope, built the way clang builds them
+			std::string usr;
+
+			// Full names of the bases of a class scope
+			std::vector<std::string> bases;
+		};
+		std::vector<Scope> scopes;
+
+		// Full names of the namespaces and types the source declares
+		std::unordered_set<std::string> namespaces;
+		std::unordered_set<std::string> types;
+
+		// Classes whose bodies were skipped, and names that skipped declarations may have declared
+		std::unordered_set<std::string> opaque;
+		std::unordered_set<std::string> unknown;
+
+		// USRs of the classes and enums that can be named, by full name
+		std::unordered_map<std::string, std::string> usrs;
+
+		// Full names of the bases of the classes whose bodies were parsed, by full name
+		// Only these classes can have their members searched, an imported class may have any members
+		std::unordered_map<std::string, std::vector<std::string>> class_bases;
+
+		// Tokens
+		const Token &Peek(size_t ahead = 0) const
+		{
+			return tokens[std::min(pos + ahead, tokens.size() - 1)];
+		}
+
+		bool Is(std::string_view text, size_t ahead = 0) const
+		{
+			const Token &token = Peek(ahead);
+			return token.type != Token::Type::End && token.text == text;
+		}
+
+		void Expect(std::string_view text)
+		{
+			if (!Is(text))
+				throw Unsupported("Expected " + std::string(text));
+			pos++;
+		}
+
+		std::string_view ExpectIdentifier()
+		{
+			if (Peek().type != Token::Type::Identifier)
+				throw Unsupported("Expected identifier");
+			return tokens[pos++].text;
+		}
+
+		static bool IsOpen(std::string_view text)
+		{
+			return text == "(" || text == "[" || text == "{";
+		}
+
+		static bool IsClose(std::string_view text)
+		{
+			return text == ")" || text == "]" || text == "}";
+		}
+
+		// Leon's attribute macros
+		static bool IsAttribute(const Token &token)
+		{
+			return token.type == Token::Type::Identifier && (token.text == "LEON" || token.text == "LEON_KV" || token.text == "LEON_V");
+		}
+
+		// Anything else that could be an annotation
+		static bool IsAnnotation(const Token &token)
+		{
+			if (token.type != Token::Type::Identifier)
+				return false;
+			if (token.text.rfind("LEON", 0) == 0)
+				return token.text != "LEON_SINGLE_FILE";
+			return token.text == "__attribute__" || token.text == "annotate";
+		}
+
+		// Names
+		static std::string Join(const std::string &scope, std::string_view name)
+		{
+			if (scope.empty())
+				return std::string(name);
+			return scope + "::" + std::string(name);
+		}
+
+		std::string ScopedName(std::string_view name) const
+		{
+			return Join(scopes.back().name, name);
+		}
+
+		// Clang marks namespaces with N, classes and structs with S, and enums with E
+		std::string ScopedUSR(char kind, std::string_view name) const
+		{
+			return scopes.back().usr + '@' + kind + '@' + std::string(name);
+		}
+
+		// Skip from an opening bracket past its matching closing bracket
+		void SkipBalanced()
+		{
+			std::vector<char> closers;
+			do
+			{
+				const Token &token = Peek();
+				if (token.type == Token::Type::End)
+					throw Unsupported("Unbalanced brackets");
+
+				if (token.text == "(")
+					closers.push_back(')');
+				else if (token.text == "[")
+					closers.push_back(']');
+				else if (token.text == "{")
+					closers.push_back('}');
+				else if (IsClose(token.text))
+				{
+					if (closers.empty() || closers.back() != token.text[0])
+						throw Unsupported("Unbalanced brackets");
+					closers.pop_back();
+				}
+				pos++;
+			} while (!closers.empty());
+		}
+
+		// Skip to just past the token at end
+		// Names at the top level of the skipped tokens might be declared by them, so they can't be resolved past
+		void SkipTo(size_t end)
+		{
+			int depth = 0;
+			for (; pos < end; pos++)
+			{
+				const Token &token = tokens[pos];
+				if (IsOpen(token.text))
+					depth++;
+				else if (IsClose(token.text))
+					depth--;
+				else if (depth == 0 && token.type == Token::Type::Identifier)
+					unknown.insert(ScopedName(token.text));
+			}
+			pos = end + 1;
+		}
+
+		// Find a name among the members of the given bases, and of their bases in turn
+		// A name found in a base hides the same name in the base's own bases, finding different declarations through different bases is ambiguous
+		void FindInBases(const std::vector<std::string> &bases, std::string_view name, std::string &found)
+		{
+			for (auto &base : bases)
+			{
+				auto base_bases = class_bases.find(base);
+				if (base_bases == class_bases.end())
+					throw Unsupported("Name may be a member of a base that wasn't parsed: " + base);
+
+				std::string candidate = Join(base, name);
+				if (unknown.count(candidate) != 0)
+					throw Unsupported("Name may refer to a skipped declaration: " + candidate);
+				if (types.count(candidate) != 0)
+				{
+					if (!found.empty() && found != candidate)
+						throw Unsupported("Ambiguous name in bases: " + std::string(name));
+					found = candidate;
+					continue;
+				}
+
+				FindInBases(base_bases->second, name, found);
+			}
+		}
+
+		// Resolve the name of a type used in the current scope to its full name
+		// Includes can add to namespaces, but not to classes, so only the class scopes around the innermost namespace are searched
+		// The members of a class's bases are searched before the scopes around the class, like C++ does
+		std::string Resolve(const std::vector<std::string_view> &parts, bool global)
+		{
+			std::string base;
+			if (global)
+			{
+				base = std::string(parts[0]);
+				if (unknown.count(base) != 0 || (types.count(base) == 0 && namespaces.count(base) == 0))
+					throw Unsupported("Unresolved name: ::" + base);
+			}
+			else
+			{
+				for (size_t s = scopes.size(); s-- > 0;)
+				{
+					std::string candidate = Join(scopes[s].name, parts[0]);
+					if (unknown.count(candidate) != 0)
+						throw Unsupported("Name may refer to a skipped declaration: " + candidate);
+					if (types.count(candidate) != 0 || namespaces.count(candidate) != 0)
+					{
+						base = candidate;
+						break;
+					}
+					if (scopes[s].is_namespace)
+						break;
+
+					FindInBases(scopes[s].bases, parts[0], base);
+					if (!base.empty())
+						break;
+				}
+				if (base.empty())
+					throw Unsupported("Unresolved name: " + std::string(parts[0]));
+			}
+
+			for (size_t i = 1; i < parts.size(); i++)
+			{
+				if (opaque.count(base) != 0)
+					throw Unsupported("Name in a skipped class: " + base);
+
+				std::string candidate = base + "::" + std::string(parts[i]);
+				if (unknown.count(candidate) != 0 || (types.count(candidate) == 0 && namespaces.count(candidate) == 0))
+					throw Unsupported("Unresolved name: " + candidate);
+				base = candidate;
+			}
+
+			if (types.count(base) == 0)
+				throw Unsupported("Not a type: " + base);
+			return base;
+		}
+
+		// Read a possibly qualified type name
+		std::string ParseTypeName()
+		{
+			bool global = false;
+			if (Is("::"))
+			{
+				global = true;
+				pos++;
+			}
+
+			std::vector<std::string_view> parts;
+			while (1)
+			{
+				parts.push_back(ExpectIdentifier());
+				if (!Is("::"))
+					break;
+				pos++;
+			}
+
+			if (Is("<"))
+				throw Unsupported("Template type");
+
+			return Resolve(parts, global);
+		}
+
+		// Read the arguments of a function-like macro, spelled like the preprocessor stringifies them
+		std::vector<std::string> ParseMacroArguments()
+		{
+			Expect("(");
+
+			std::vector<std::string> args(1);
+			int depth = 0;
+			while (1)
+			{
+				const Token &token = Peek();
+				if (token.type == Token::Type::End)
+					throw Unsupported("Unterminated macro arguments");
+				pos++;
+
+				if (token.text == ")" && depth-- == 0)
+					break;
+				if (token.text == "(")
+					depth++;
+
+				if (token.text == "," && depth == 0)
+				{
+					args.emplace_back();
+					continue;
+				}
+
+				if (!args.back().empty() && token.space_before)
+					args.back() += ' ';
+				args.back() += token.text;
+			}
+
+			return args;
+		}
+
+		// Read the Leon attributes at the current token
+		void ParseAttributes(std::pmr::vector<Leon::Parse::LeonAttr> &attrs)
+		{
+			while (IsAttribute(Peek()))
+			{
+				std::string_view macro = tokens[pos++].text;
+
+				// Build the string the macro annotates with
+				std::string src;
+				if (macro == "LEON")
+				{
+					src = "@leon";
+				}
+				else if (macro == "LEON_KV")
+				{
+					auto args = ParseMacroArguments();
+					if (args.size() != 2)
+						throw Unsupported("LEON_KV takes 2 arguments");
+					src = "@leonkv " + args[0] + " " + args[1];
+				}
+				else
+				{
+					auto args = ParseMacroArguments();
+					if (args.size() != 1)
+						throw Unsupported("LEON_V takes 1 argument");
+					src = "@leonkv " + args[0] + " \"true\"";
+				}
+
+				Leon::Parse::LeonAttr attr = Leon::Parse::ParseAttribute(context, src);
+				if (attr.type != Leon::Parse::LeonAttr::Type::Invalid)
+					attrs.push_back(attr);
+			}
+
+			// The order clang keeps several attributes in isn't something we can promise to match
+			if (attrs.size() > 1)
+				throw Unsupported("Multiple attributes");
+		}
+
+		// Register a type the way Parse's RegisterType does for scalars, enums and classes
+		// Those are their own root, and a qualified type's unqualified type is registered right after it
+		Leon::Parse::TypeId RegisterType(const std::string &name, bool q_const, bool q_volatile)
+		{
+			std::string full;
+			if (q_const)
+				full += "const";
+			if (q_volatile)
+			{
+				if (!full.empty())
+					full += ' ';
+				full += "volatile";
+			}
+			if (!full.empty())
+				full += ' ';
+			full += name;
+
+			auto it = context.type_ids.find(full);
+			if (it != context.type_ids.end())
+				return it->second;
+
+			Leon::Parse::TypeId id = static_cast<Leon::Parse::TypeId>(context.types.size());
+			context.types.emplace_back(&context.arena);
+
+			Leon::Parse::TypeNode node(&context.arena);
+
+			node.id = id;
+			node.name = context.Intern(full);
+
+			context.type_ids.emplace(node.name, id);
+
+			node.type = Leon::Parse::TypeNode::Type::Type;
+			node.q_const = q_const;
+			node.q_volatile = q_volatile;
+
+			node.root = id;
+			node.unqualified = (q_const || q_volatile) ? RegisterType(name, false, false) : id;
+			node.unqualified_root = node.unqualified;
+
+			auto usr = usrs.find(name);
+			if (usr != usrs.end())
+				node.usr = context.Intern(usr->second);
+
+			context.types[id] = std::move(node);
+			return id;
+		}
+
+		// Skip a declaration that isn't registered, like a typedef, variable, or unannotated function
+		// libclang's visitor steps into some of these, so anything annotated is left to it
+		void SkipDeclaration()
+		{
+			if (Is("using") && Is("namespace", 1))
+				throw Unsupported("Using directive");
+
+			size_t end = pos;
+			int depth = 0;
+			while (1)
+			{
+				const Token &token = tokens[end];
+				if (token.type == Token::Type::End)
+					throw Unsupported("Unterminated declaration");
+				if (IsAttribute(token) || IsAnnotation(token))
+					throw Unsupported("Annotated declaration");
+
+				if (IsOpen(token.text))
+				{
+					depth++;
+				}
+				else if (IsClose(token.text))
+				{
+					if (depth-- == 0)
+						throw Unsupported("Unbalanced declaration");
+
+					// A function body ends the declaration
+					if (depth == 0 && token.text == "}" && IsFunctionBody(end))
+						break;
+				}
+				else if (depth == 0 && token.text == ";")
+				{
+					break;
+				}
+				end++;
+			}
+
+			SkipTo(end);
+		}
+
+		// Check if the braces closing at end are a function body
+		bool IsFunctionBody(size_t end) const
+		{
+			// Find the opening brace
+			int depth = 0;
+			size_t open = end;
+			while (1)
+			{
+				if (tokens[open].text == "}")
+					depth++;
+				else if (tokens[open].text == "{" && --depth == 0)
+					break;
+				open--;
+			}
+
+			if (open == 0)
+				return false;
+
+			std::string_view before = tokens[open - 1].text;
+			return before == ")" || before == "const" || before == "noexcept" || before == "override" || before == "final";
+		}
+
+		// Enums
+		void ParseEnum()
+		{
+			Expect("enum");
+			if (Is("class") || Is("struct"))
+				pos++;
+
+			std::pmr::vector<Leon::Parse::LeonAttr> attrs(&context.arena);
+			ParseAttributes(attrs);
+
+			if (Peek().type != Token::Type::Identifier)
+				throw Unsupported("Anonymous enum");
+			std::string usr = ScopedUSR('E', tokens[pos].text);
+			std::string name = ScopedName(tokens[pos++].text);
+
+			// Underlying type, values outside of an unsigned one would wrap
+			bool is_unsigned = false;
+			if (Is(":"))
+			{
+				pos++;
+
+				BuiltinType underlying;
+				while (Peek().type == Token::Type::Identifier && underlying.Add(Peek().text))
+					pos++;
+
+				std::string underlying_name = underlying.Name();
+				if (underlying_name == "char" || underlying_name == "bool" || underlying_name == "float" || underlying_name == "double" || underlying_name == "long double" || underlying_name == "wchar_t" || underlying_name.rfind("char", 0) == 0)
+					throw Unsupported("Unexpected underlying type: " + underlying_name);
+
+				is_unsigned = underlying_name.rfind("unsigned", 0) == 0;
+			}
+
+			// Opaque declaration
+			if (Is(";"))
+			{
+				if (!attrs.empty())
+					throw Unsupported("Annotated opaque enum");
+				pos++;
+				return;
+			}
+
+			if (!Is("{"))
+				throw Unsupported("Expected enum body");
+
+			types.insert(name);
+			usrs[name] = usr;
+
+			// Unannotated enums aren't registered, libclang stops at their first element
+			if (attrs.empty())
+			{
+				SkipBalanced();
+				Expect(";");
+				return;
+			}
+			pos++;
+
+			Leon::Parse::EnumNode node(&context.arena);
+			node.attrs = std::move(attrs);
+
+			std::unordered_map<std::string_view, long long> values;
+			long long current_value = 0;
+
+			while (!Is("}"))
+			{
+				std::string_view elem_name = ExpectIdentifier();
+				std::string_view elem = context.Intern(elem_name);
+
+				if (current_value > INT_MAX)
+					throw Unsupported("Enum value out of range");
+				node.elems[elem] = current_value++;
+
+				if (Is("="))
+				{
+					pos++;
+
+					long long value = ParseEnumValue(values);
+					if (is_unsigned && value < 0)
+						throw Unsupported("Negative value in unsigned enum");
+
+					node.elems[elem] = value;
+					current_value = value + 1;
+				}
+				values[elem_name] = node.elems[elem];
+
+				if (Is(","))
+					pos++;
+				else if (!Is("}"))
+					throw Unsupported("Unexpected token in enum");
+			}
+			pos++;
+			Expect(";");
+
+			std::string_view interned = context.Intern(name);
+			node.name = interned;
+			node.usr = context.Intern(usr);
+			context.enum_nodes.emplace(interned, std::move(node));
+		}
+
+		// Evaluate an enum element's value
+		// Integers and earlier elements, added and subtracted
+		long long ParseEnumValue(const std::unordered_map<std::string_view, long long> &values)
+		{
+			long long value = 0;
+			bool first = true;
+
+			while (1)
+			{
+				int sign = 1;
+				if (!first)
+				{
+					if (Is("-"))
+						sign = -1;
+					else if (!Is("+"))
+						break;
+					pos++;
+				}
+
+				// Unary signs
+				while (Is("-") || Is("+"))
+				{
+					if (Is("-"))
+						sign = -sign;
+					pos++;
+				}
+
+				const Token &token = Peek();
+				long long term;
+				if (token.type == Token::Type::Number)
+				{
+					term = ParseInteger(token.text);
+				}
+				else if (token.type == Token::Type::Identifier)
+				{
+					auto it = values.find(token.text);
+					if (it == values.end())
+						throw Unsupported("Unknown name in enum value: " + std::string(token.text));
+					term = it->second;
+				}
+				else
+				{
+					throw Unsupported("Unexpected token in enum value");
+				}
+				pos++;
+
+				value += sign * term;
+				if (value < INT_MIN || value > INT_MAX)
+					throw Unsupported("Enum value out of range");
+
+				first = false;
+			}
+
+			if (!Is(",") && !Is("}"))
+				throw Unsupported("Unexpected token in enum value");
+			return value;
+		}
+
+		// Classes
+		void ParseClass()
+		{
+			bool is_struct = Is("struct");
+			pos++;
+
+			std::pmr::vector<Leon::Parse::LeonAttr> attrs(&context.arena);
+			ParseAttributes(attrs);
+
+			if (Peek().type != Token::Type::Identifier)
+				throw Unsupported("Anonymous class");
+			std::string usr = ScopedUSR('S', tokens[pos].text);
+			std::string name = ScopedName(tokens[pos++].text);
+
+			// Forward declaration
+			if (Is(";"))
+			{
+				if (!attrs.empty())
+					throw Unsupported("Annotated forward declaration");
+				pos++;
+				return;
+			}
+
+			// Base classes
+			std::pmr::vector<Leon::Parse::ClassNode::Base> bases(&context.arena);
+			std::vector<std::string> base_names;
+			if (Is(":"))
+			{
+				pos++;
+				while (1)
+				{
+					Leon::Parse::ClassNode::Base base;
+					base.visibility = is_struct ? Leon::Parse::ClassNode::Visibility::Public : Leon::Parse::ClassNode::Visibility::Private;
+					if (Is("virtual"))
+						throw Unsupported("Virtual base");
+
+					if (Is("public") || Is("protected") || Is("private"))
+					{
+						if (Is("public"))
+							base.visibility = Leon::Parse::ClassNode::Visibility::Public;
+						else if (Is("protected"))
+							base.visibility = Leon::Parse::ClassNode::Visibility::Protected;
+						else
+							base.visibility = Leon::Parse::ClassNode::Visibility::Private;
+						pos++;
+					}
+
+					if (Is("virtual"))
+						throw Unsupported("Virtual base");
+
+					std::string base_name = ParseTypeName();
+
+					// Only a skipped class could have members we can't see
+					if (opaque.count(base_name) != 0)
+						throw Unsupported("Base is a skipped class: " + base_name);
+
+					base.base_class = context.Intern(base_name);
+					bases.emplace_back(std::move(base));
+					base_names.push_back(std::move(base_name));
+
+					if (!Is(","))
+						break;
+					pos++;
+				}
+			}
+
+			if (!Is("{"))
+				throw Unsupported("Class with specifiers");
+
+			types.insert(name);
+			usrs[name] = usr;
+
+			// Unannotated classes aren't registered, libclang stops at their first member
+			if (attrs.empty())
+			{
+				opaque.insert(name);
+				SkipBalanced();
+				Expect(";");
+				return;
+			}
+			pos++;
+
+			Leon::Parse::ClassNode node(&context.arena);
+			node.attrs = std::move(attrs);
+			node.bases = std::move(bases);
+
+			class_bases[name] = base_names;
+			scopes.push_back({ name, false, usr, std::move(base_names) });
+			ParseMembers(node, is_struct ? Leon::Parse::ClassNode::Visibility::Public : Leon::Parse::ClassNode::Visibility::Private);
+			scopes.pop_back();
+
+			Expect("}");
+			Expect(";");
+
+			std::string_view interned = context.Intern(name);
+			node.name = interned;
+			node.usr = context.Intern(usr);
+			node.class_type = is_struct ? Leon::Parse::ClassNode::ClassType::Struct : Leon::Parse::ClassNode::ClassType::Class;
+			node.q_abstract = false;
+			context.class_nodes.emplace(interned, std::move(node));
+		}
+
+		void ParseMembers(Leon::Parse::ClassNode &node, Leon::Parse::ClassNode::Visibility visibility)
+		{
+			while (!Is("}"))
+			{
+				if (Peek().type == Token::Type::End)
+					throw Unsupported("Unterminated class");
+
+				if (Is(";"))
+				{
+					pos++;
+				}
+				else if (Is(":", 1) && (Is("public") || Is("protected") || Is("private")))
+				{
+					if (Is("public"))
+						visibility = Leon::Parse::ClassNode::Visibility::Public;
+					else if (Is("protected"))
+						visibility = Leon::Parse::ClassNode::Visibility::Protected;
+					else
+						visibility = Leon::Parse::ClassNode::Visibility::Private;
+					pos += 2;
+				}
+				else if (Is("struct") || Is("class"))
+				{
+					ParseClass();
+				}
+				else if (Is("enum"))
+				{
+					ParseEnum();
+				}
+				else
+				{
+					ParseMember(node, visibility);
+				}
+			}
+		}
+
+		// Data members
+		// Unannotated members aren't registered, so they're skipped as long as they aren't functions
+		void ParseMember(Leon::Parse::ClassNode &node, Leon::Parse::ClassNode::Visibility visibility)
+		{
+			// Find the end of the member
+			size_t end = pos;
+			bool annotated = false;
+			{
+				int depth = 0;
+				bool initializer = false;
+				for (;; end++)
+				{
+					const Token &token = tokens[end];
+					if (token.type == Token::Type::End)
+						throw Unsupported("Unterminated member");
+
+					if (IsAttribute(token))
+					{
+						// Step over the macro's arguments
+						annotated = true;
+						if (tokens[end + 1].text == "(")
+						{
+							int args_depth = 0;
+							do
+							{
+								end++;
+								if (tokens[end].type == Token::Type::End)
+									throw Unsupported("Unterminated macro arguments");
+								if (tokens[end].text == "(")
+									args_depth++;
+								else if (tokens[end].text == ")")
+									args_depth--;
+							} while (args_depth != 0);
+						}
+						continue;
+					}
+					else if (IsAnnotation(token))
+						throw Unsupported("Unknown annotation");
+
+					if (IsOpen(token.text))
+					{
+						if (depth == 0 && token.text == "(" && !initializer)
+							throw Unsupported("Member function");
+						depth++;
+					}
+					else if (IsClose(token.text))
+					{
+						if (depth-- == 0)
+							throw Unsupported("Unbalanced member");
+					}
+					else if (depth == 0 && token.text == "=")
+					{
+						initializer = true;
+					}
+					else if (depth == 0 && token.text == ";")
+					{
+						break;
+					}
+				}
+			}
+
+			if (!annotated)
+			{
+				SkipTo(end);
+				return;
+			}
+
+			// Read the specifiers up to the member's name
+			std::pmr::vector<Leon::Parse::LeonAttr> attrs(&context.arena);
+			bool is_static = false, q_const = false, q_volatile = false;
+			BuiltinType builtin;
+			std::string type_name;
+			std::string_view name;
+
+			while (name.empty())
+			{
+				const Token &token = Peek();
+				if (IsAttribute(token))
+				{
+					ParseAttributes(attrs);
+					continue;
+				}
+				if (token.type != Token::Type::Identifier && token.text != "::")
+					throw Unsupported("Unexpected token in member");
+
+				if (token.text == "static")
+				{
+					is_static = true;
+				}
+				else if (token.text == "const")
+				{
+					q_const = true;
+				}
+				else if (token.text == "volatile")
+				{
+					q_volatile = true;
+				}
+				else if (token.type == Token::Type::Identifier && builtin.Add(token.text))
+				{
+				}
+				else if (type_name.empty() && builtin.Empty())
+				{
+					type_name = ParseTypeName();
+					continue;
+				}
+				else
+				{
+					name = token.text;
+				}
+				pos++;
+			}
+
+			ParseAttributes(attrs);
+
+			if (Is(";") || Is("=") || Is("{"))
+				pos = end + 1;
+			else
+				throw Unsupported("Unexpected token after member name");
+
+			if (type_name.empty() == builtin.Empty())
+				throw Unsupported("Member type");
+
+			Leon::Parse::ClassNode::Member member(&context.arena);
+			member.attrs = std::move(attrs);
+			member.name = context.Intern(name);
+			member.visibility = visibility;
+			member.member_type = is_static ? Leon::Parse::ClassNode::Member::MemberType::Static : Leon::Parse::ClassNode::Member::MemberType::Member;
+			member.type = RegisterType(type_name.empty() ? builtin.Name() : type_name, q_const, q_volatile);
+
+			node.members.emplace_back(std::move(member));
+		}
+
+		// Namespaces
+		void ParseNamespace()
+		{
+			Expect("namespace");
+
+			std::string name = scopes.back().name;
+			std::string usr = scopes.back().usr;
+			while (1)
+			{
+				std::string_view part = ExpectIdentifier();
+				if (part == "inline")
+					throw Unsupported("Inline namespace");
+
+				name = Join(name, part);
+				usr += "@N@" + std::string(part);
+				namespaces.insert(name);
+
+				if (!Is("::"))
+					break;
+				pos++;
+			}
+
+			Expect("{");
+
+			scopes.push_back({ name, true, usr });
+			ParseDeclarations();
+			scopes.pop_back();
+
+			Expect("}");
+		}
+
+		void ParseDeclarations()
+		{
+			while (Peek().type != Token::Type::End && !Is("}"))
+			{
+				if (Is(";") || Is("LEON_SINGLE_FILE"))
+					pos++;
+				else if (Is("namespace"))
+					ParseNamespace();
+				else if (Is("struct") || Is("class"))
+					ParseClass();
+				else if (Is("enum"))
+					ParseEnum();
+				else
+					SkipDeclaration();
+			}
+		}
+
+	public:
+		Parser(Leon::Parse::Context &_context, std::vector<Token> &&_tokens) : context(_context), tokens(std::move(_tokens)) {}
+
+		// Add the declarations of a model the source can name
+		void Import(const Leon::Model::Model &model)
+		{
+			// Only what the model's sources reflected, types they only referenced may be specializations we can't name
+			std::unordered_set<std::string> names;
+			for (auto &i : model.declarations)
+			{
+				auto &declaration = i.second;
+				if (declaration.kind == Leon::Model::Declaration::Kind::Type)
+					continue;
+				names.insert(declaration.name);
+
+				// Naming a class template needs its arguments, which we don't parse
+				if (declaration.kind == Leon::Model::Declaration::Kind::ClassTemplate)
+				{
+					unknown.insert(declaration.name);
+				}
+				else
+				{
+					types.insert(declaration.name);
+					usrs[declaration.name] = i.first;
+				}
+			}
+
+			// Whatever encloses a declaration can qualify names, only its types are reflected
+			for (auto &name : names)
+			{
+				for (size_t scope = name.find("::"); scope != std::string::npos; scope = name.find("::", scope + 2))
+				{
+					std::string scope_name = name.substr(0, scope);
+					if (names.count(scope_name) == 0)
+						namespaces.insert(scope_name);
+				}
+			}
+		}
+
+		void Parse()
+		{
+			scopes.push_back({ "", true, "c:" });
+			ParseDeclarations();
+
+			if (Peek().type != Token::Type::End)
+				throw Unsupported("Unbalanced braces");
+		}
+};
+
+bool ParseSource(const std::filesystem::path &path, Leon::Parse::Context &context, const Leon::Model::Model *imports)
+{
+	std::string src;
+	{
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream)
+			return false;
+
+		std::stringstream sstream;
+		sstream << stream.rdbuf();
+		src = sstream.str();
+	}
+
+	// Anything we don't handle, including an error libclang should be the one to report, falls back to libclang
+	try
+	{
+		Parser parser(context, Tokenize(src));
+		if (imports != nullptr)
+			parser.Import(*imports);
+		parser.Parse();
+	}
+	catch (std::exception &)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+}
+}
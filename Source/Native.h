@@ -0,0 +1,43 @@
+/*
+ * [ Leon ]
+ *   Source/Native.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Parse.h"
+#include "Model.h"
+
+#include <filesystem>
+
+namespace Leon
+{
+namespace Native
+{
+
+// Parse a source without libclang
+// Handles namespaces, and annotated structs, classes and enums whose members are scalars or types the source itself declares.
+// Declarations are registered in the same order libclang's visitor would, so the context is identical to a libclang parse.
+// Types and base classes can also come from imported models, for sources including the headers other targets reflected.
+// Returns false for a source using anything else, leaving the context partially filled, so it should be discarded and the source parsed by libclang.
+bool ParseSource(const std::filesystem::path &path, Leon::Parse::Context &context, const Leon::Model::Model *imports = nullptr);
+
+}
+}
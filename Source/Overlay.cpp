@@ -0,0 +1,100 @@
+/*
+ * [ Leon ]
+ *   Source/Overlay.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Overlay.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace Leon
+{
+namespace Overlay
+{
+
+// In-memory file overlay
+bool Overlay::ReadRecord(std::istream &stream, std::string &path, std::string &contents)
+{
+	// Blank lines between records are skipped
+	do
+	{
+		if (!std::getline(stream, path))
+			return false;
+		if (!path.empty() && path.back() == '\r')
+			path.pop_back();
+	} while (path.empty());
+
+	std::string size_line;
+	if (!std::getline(stream, size_line))
+		throw std::runtime_error("Overlay record for " + path + " has no size");
+
+	size_t size;
+	try
+	{
+		size = std::stoull(size_line);
+	}
+	catch (std::exception &)
+	{
+		throw std::runtime_error("Overlay record for " + path + " has an invalid size: " + size_line);
+	}
+
+	contents.resize(size);
+	if (!stream.read(contents.data(), size))
+		throw std::runtime_error("Overlay record for " + path + " is cut short");
+
+	return true;
+}
+
+std::string Overlay::GetPath(const std::string &path)
+{
+	std::string utf8 = std::filesystem::weakly_canonical(std::filesystem::path(path)).string();
+	for (auto &i : utf8)
+		if (i == '\\')
+			i = '/';
+	return utf8;
+}
+
+void Overlay::Set(const std::string &path, std::string &&contents)
+{
+	files[path] = std::move(contents);
+
+	// Rebuild the unsaved files, as setting a file may have moved the others' contents
+	unsaved_files.clear();
+	for (auto &i : files)
+	{
+		CXUnsavedFile unsaved_file;
+		unsaved_file.Filename = i.first.c_str();
+		unsaved_file.Contents = i.second.data();
+		unsaved_file.Length = static_cast<unsigned long>(i.second.size());
+		unsaved_files.push_back(unsaved_file);
+	}
+}
+
+const std::string *Overlay::Find(const std::string &path) const
+{
+	auto it = files.find(path);
+	if (it == files.end())
+		return nullptr;
+	return &it->second;
+}
+
+}
+}
@@ -0,0 +1,73 @@
+/*
+ * [ Leon ]
+ *   Source/Overlay.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <clang-c/Index.h>
+
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Leon
+{
+namespace Overlay
+{
+
+// In-memory file overlay
+// Files whose contents are given in memory instead of read from disk, like headers generated earlier in the build or an editor's unsaved buffers.
+// They're passed to libclang as unsaved files, so they don't have to exist on disk at all.
+class Overlay
+{
+	private:
+		// Contents by path
+		std::map<std::string, std::string> files;
+		std::vector<CXUnsavedFile> unsaved_files;
+
+	public:
+		// Read a single record from a stream
+		// A record is the file's path on a line, its size in bytes on the next, and then exactly that many bytes of contents.
+		// Returns false once the stream ends between records, and throws if a record is cut short.
+		static bool ReadRecord(std::istream &stream, std::string &path, std::string &contents);
+
+		// Get the path a file is overlaid by
+		// Overlaid files don't have to exist, so only the part of the path that does is resolved
+		static std::string GetPath(const std::string &path);
+
+		// Set a file's contents, replacing any it already had
+		void Set(const std::string &path, std::string &&contents);
+
+		// Get a file's contents, nullptr if it isn't overlaid
+		const std::string *Find(const std::string &path) const;
+
+		const std::map<std::string, std::string> &GetFiles() const { return files; }
+		bool Empty() const { return files.empty(); }
+
+		// Unsaved files for libclang
+		// Only valid until the overlay is next changed
+		CXUnsavedFile *GetUnsavedFiles() const { return const_cast<CXUnsavedFile *>(unsaved_files.data()); }
+		unsigned int GetNumUnsavedFiles() const { return static_cast<unsigned int>(unsaved_files.size()); }
+};
+
+}
+}
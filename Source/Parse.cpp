@@ -22,6 +22,7 @@
 
 #include "Parse.h"
 
+#include <cstring>
 #include <istream>
 #include <iostream>
 #include <sstream>
@@ -31,8 +32,17 @@ namespace Leon
 namespace Parse
 {
 
+// Context arena
+std::string_view Context::Intern(std::string_view str)
+{
+	char *data = static_cast<char *>(arena.allocate(str.size() + 1, alignof(char)));
+	memcpy(data, str.data(), str.size());
+	data[str.size()] = '\0';
+	return std::string_view(data, str.size());
+}
+
 // Parse a @leon attribute
-static LeonAttr ParseAttribute(const std::string &src)
+LeonAttr ParseAttribute(Context &context, const std::string &src)
 {
 	LeonAttr attr;
 
@@ -52,8 +62,8 @@ static LeonAttr ParseAttribute(const std::string &src)
 	{
 		case LeonAttr::Type::KeyValue:
 		{
-			attr.kv.first = ParseString(src_stream);
-			attr.kv.second = ParseString(src_stream);
+			attr.kv.first = context.Intern(ParseString(src_stream));
+			attr.kv.second = context.Intern(ParseString(src_stream));
 			if (attr.kv.first.empty() || attr.kv.second.empty())
 			{
 				attr.type = LeonAttr::Type::Invalid;
@@ -68,60 +78,49 @@ static LeonAttr ParseAttribute(const std::string &src)
 	return attr;
 }
 
-// Parse attributes from a cursor
-static std::vector<LeonAttr> ParseCXCursorAttributes(CXCursor cursor)
+// Parse an annotation attribute cursor into a list of attributes
+static void AddAttribute(Context &context, std::pmr::vector<LeonAttr> &attrs, CXCursor cursor)
 {
-	struct VisitorClient
-	{
-		std::vector<LeonAttr> attrs;
-	} client;
-
-	auto visitor = [](CXCursor cursor, CXCursor parent, CXClientData clientData) -> CXChildVisitResult
-		{
-			auto &client = *(reinterpret_cast<VisitorClient *>(clientData));
-
-			if (cursor.kind == CXCursor_AnnotateAttr)
-			{
-				std::string src = GetCXString(clang_getCursorSpelling(cursor));
-				LeonAttr attr = ParseAttribute(src);
-				if (attr.type != LeonAttr::Type::Invalid)
-					client.attrs.push_back(attr);
-				return CXChildVisit_Continue;
-			}
-
-			return CXChildVisit_Continue;
-		};
-
-	clang_visitChildren(cursor, visitor, &client);
-
-	return client.attrs;
+	std::string src = GetCXString(clang_getCursorSpelling(cursor));
+	LeonAttr attr = ParseAttribute(context, src);
+	if (attr.type != LeonAttr::Type::Invalid)
+		attrs.push_back(attr);
 }
 
 // Get the full name of a cursor declaration
-static std::string GetCXCursorName(CXCursor cx_cursor)
+// Names are cached in the context, so each parent's name is only built once and children append to it
+static std::string_view GetCXCursorName(Context &context, CXCursor cx_cursor)
 {
-	std::string name = GetCXString(clang_getCursorSpelling(cx_cursor));
+	unsigned int hash = clang_hashCursor(cx_cursor);
 
-	while (1)
+	auto range = context.cursor_names.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
 	{
-		// Get the parent cursor to step up a level
-		cx_cursor = clang_getCursorSemanticParent(cx_cursor);
-		if (clang_isInvalid(cx_cursor.kind) || clang_isTranslationUnit(cx_cursor.kind))
-			break;
-		if (clang_isUnexposed(cx_cursor.kind))
-			continue;
+		if (clang_equalCursors(it->second.first, cx_cursor))
+			return it->second.second;
+	}
 
-		// Append parent to name
-		name = GetCXString(clang_getCursorSpelling(cx_cursor)) + "::" + name;
+	// Get the parent cursor to step up a level
+	CXCursor parent = clang_getCursorSemanticParent(cx_cursor);
+	while (!clang_isInvalid(parent.kind) && !clang_isTranslationUnit(parent.kind) && clang_isUnexposed(parent.kind))
+		parent = clang_getCursorSemanticParent(parent);
+
+	// Append name to parent
+	std::string name;
+	if (!clang_isInvalid(parent.kind) && !clang_isTranslationUnit(parent.kind))
+	{
+		name = GetCXCursorName(context, parent);
+		name += "::";
 	}
+	name += GetCXString(clang_getCursorSpelling(cx_cursor));
 
-	return name;
+	return context.cursor_names.emplace(hash, std::make_pair(cx_cursor, context.Intern(name)))->second.second;
 }
 
 // Get the name of a cursor
-static std::string GetCXCursorString(CXCursor cursor)
+static std::string GetCXCursorString(Context &context, CXCursor cursor)
 {
-	return GetCXString(clang_getCursorKindSpelling(cursor.kind)) + " (" + GetCXCursorName(cursor) + ")";
+	return GetCXString(clang_getCursorKindSpelling(cursor.kind)) + " (" + std::string(GetCXCursorName(context, cursor)) + ")";
 }
 
 // Check a CXType for support
@@ -180,70 +179,114 @@ static std::string GetQualString(CXType cx_type)
 	return out;
 }
 
-// Get the full name of a CXType
-static std::string GetCXTypeName(CXType cx_type)
-{
-	// Get global name
-	CXType root = GetCXTypeRoot(cx_type);
-	CheckCXType(root);
+static std::string GetCXTypeName(Context &context, CXType cx_type);
 
+// Get the declaration of a root type
+// A dependent specialization inside a template declares the template itself, which has no type or arguments of its own, so it's named by its spelling
+static CXCursor GetCXTypeDeclaration(CXType root)
+{
 	CXCursor cursor = clang_getTypeDeclaration(root);
+	if (cursor.kind == CXCursor_ClassTemplate)
+		return clang_getNullCursor();
+	return cursor;
+}
 
-	std::string global_name;
-	if (!clang_isInvalid(cursor.kind))
+// Get the USR of a class or enum declaration
+// Anything else has an empty USR, as only classes and enums are shared between sources
+static std::string_view GetCXCursorUSR(Context &context, CXCursor cursor)
+{
+	switch (cursor.kind)
 	{
-		global_name = GetCXCursorName(cursor);
+		case CXCursor_ClassDecl:
+		case CXCursor_StructDecl:
+		case CXCursor_UnionDecl:
+		case CXCursor_EnumDecl:
+		case CXCursor_ClassTemplate:
+			return context.Intern(GetCXString(clang_getCursorUSR(cursor)));
+		default:
+			return "";
 	}
-	else
+}
+
+// Get the full name of a declaration, with the template arguments of a specialization
+// Names are cached in the context, so a specialization's arguments are only walked once no matter how often it's used
+static std::string_view GetCXSpecializationName(Context &context, CXCursor cursor)
+{
+	unsigned int hash = clang_hashCursor(cursor);
+
+	auto range = context.specialization_names.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
 	{
-		global_name = GetCXString(clang_getTypeSpelling(clang_getUnqualifiedType(root)));
+		if (clang_equalCursors(it->second.first, cursor))
+			return it->second.second;
 	}
 
+	std::string_view cursor_name = GetCXCursorName(context, cursor);
+
 	// Apply template parameters
-	if (!clang_isInvalid(cursor.kind))
+	int template_num = clang_Cursor_getNumTemplateArguments(cursor);
+	if (template_num < 0)
+		return context.specialization_names.emplace(hash, std::make_pair(cursor, cursor_name))->second.second;
+
+	std::string global_name(cursor_name);
+	global_name += '<';
+
+	for (unsigned int t = 0; t < template_num; t++)
 	{
-		int template_num = clang_Cursor_getNumTemplateArguments(cursor);
+		if (t)
+			global_name += ", ";
 
-		if (template_num >= 0)
+		auto t_kind = clang_Cursor_getTemplateArgumentKind(cursor, t);
+		switch (t_kind)
 		{
-			global_name += '<';
+			case CXTemplateArgumentKind_Type:
+				global_name += GetCXTypeName(context, clang_Cursor_getTemplateArgumentType(cursor, t));
+				break;
+			case CXTemplateArgumentKind_NullPtr:
+				global_name += "nullptr";
+				break;
+			case CXTemplateArgumentKind_Integral:
+				global_name += std::to_string(clang_Cursor_getTemplateArgumentValue(cursor, t));
+				break;
+			case CXTemplateArgumentKind_Null:
+				throw std::runtime_error("CXTemplateArgumentKind_Null: " + global_name);
+			case CXTemplateArgumentKind_Declaration:
+				throw std::runtime_error("CXTemplateArgumentKind_Declaration: " + global_name);
+			case CXTemplateArgumentKind_Template:
+				throw std::runtime_error("CXTemplateArgumentKind_Template: " + global_name);
+			case CXTemplateArgumentKind_TemplateExpansion:
+				throw std::runtime_error("CXTemplateArgumentKind_TemplateExpansion: " + global_name);
+			case CXTemplateArgumentKind_Expression:
+				throw std::runtime_error("CXTemplateArgumentKind_Expression: " + global_name);
+			case CXTemplateArgumentKind_Pack:
+				throw std::runtime_error("CXTemplateArgumentKind_Pack: " + global_name);
+			case CXTemplateArgumentKind_Invalid:
+				throw std::runtime_error("Could not deduce template argument type: " + global_name);
+		}
+	}
 
-			for (unsigned int t = 0; t < template_num; t++)
-			{
-				if (t)
-					global_name += ", ";
+	global_name += '>';
 
-				auto t_kind = clang_Cursor_getTemplateArgumentKind(cursor, t);
-				switch (t_kind)
-				{
-					case CXTemplateArgumentKind_Type:
-						global_name += GetCXTypeName(clang_Cursor_getTemplateArgumentType(cursor, t));
-						break;
-					case CXTemplateArgumentKind_NullPtr:
-						global_name += "nullptr";
-						break;
-					case CXTemplateArgumentKind_Integral:
-						global_name += std::to_string(clang_Cursor_getTemplateArgumentValue(cursor, t));
-						break;
-					case CXTemplateArgumentKind_Null:
-						throw std::runtime_error("CXTemplateArgumentKind_Null: " + global_name);
-					case CXTemplateArgumentKind_Declaration:
-						throw std::runtime_error("CXTemplateArgumentKind_Declaration: " + global_name);
-					case CXTemplateArgumentKind_Template:
-						throw std::runtime_error("CXTemplateArgumentKind_Template: " + global_name);
-					case CXTemplateArgumentKind_TemplateExpansion:
-						throw std::runtime_error("CXTemplateArgumentKind_TemplateExpansion: " + global_name);
-					case CXTemplateArgumentKind_Expression:
-						throw std::runtime_error("CXTemplateArgumentKind_Expression: " + global_name);
-					case CXTemplateArgumentKind_Pack:
-						throw std::runtime_error("CXTemplateArgumentKind_Pack: " + global_name);
-					case CXTemplateArgumentKind_Invalid:
-						throw std::runtime_error("Could not deduce template argument type: " + global_name);
-				}
-			}
+	return context.specialization_names.emplace(hash, std::make_pair(cursor, context.Intern(global_name)))->second.second;
+}
 
-			global_name += '>';
-		}
+// Get the full name of a CXType
+static std::string GetCXTypeName(Context &context, CXType cx_type)
+{
+	// Get global name
+	CXType root = GetCXTypeRoot(cx_type);
+	CheckCXType(root);
+
+	CXCursor cursor = GetCXTypeDeclaration(root);
+
+	std::string global_name;
+	if (!clang_isInvalid(cursor.kind))
+	{
+		global_name = GetCXSpecializationName(context, cursor);
+	}
+	else
+	{
+		global_name = GetCXString(clang_getTypeSpelling(clang_getUnqualifiedType(root)));
 	}
 
 	// Apply qualifications
@@ -287,21 +330,35 @@ static std::string GetCXTypeName(CXType cx_type)
 }
 
 // Type registry
-std::unordered_map<std::string, TypeNode> type_nodes;
-
-std::string RegisterType(CXType cx_type)
+static TypeId RegisterType(Context &context, CXType cx_type)
 {
-	std::string name = GetCXTypeName(cx_type);
+	// Check if this exact type was already registered
+	auto cached = context.type_cache.find(cx_type.data[0]);
+	if (cached != context.type_cache.end())
+		return cached->second;
 
-	// Check if type was already registered
-	auto it = type_nodes.find(name);
-	if (it != type_nodes.end())
-		return it->first;
+	// Different clang types can still end up with the same name
+	std::string name = GetCXTypeName(context, cx_type);
+
+	auto it = context.type_ids.find(name);
+	if (it != context.type_ids.end())
+	{
+		context.type_cache.emplace(cx_type.data[0], it->second);
+		return it->second;
+	}
 
 	// Register new type
-	auto &node = type_nodes[name];
+	// The node is built separately, as registering the types it refers to grows the table
+	TypeId id = static_cast<TypeId>(context.types.size());
+	context.types.emplace_back(&context.arena);
+
+	TypeNode node(&context.arena);
 
-	node.name = name;
+	node.id = id;
+	node.name = context.Intern(name);
+
+	context.type_ids.emplace(node.name, id);
+	context.type_cache.emplace(cx_type.data[0], id);
 
 	switch (cx_type.kind)
 	{
@@ -334,25 +391,26 @@ std::string RegisterType(CXType cx_type)
 	node.q_restrict = clang_isRestrictQualifiedType(cx_type);
 
 	CXType root = GetCXTypeRoot(cx_type);
-	node.root = RegisterType(root);
+	node.root = RegisterType(context, root);
 
-	CXCursor cursor = clang_getTypeDeclaration(root);
+	CXCursor cursor = GetCXTypeDeclaration(root);
 
-	node.unqualified = RegisterType(clang_getUnqualifiedType(cx_type));
+	node.unqualified = RegisterType(context, clang_getUnqualifiedType(cx_type));
 	if (!clang_isInvalid(cursor.kind))
 	{
-		node.unqualified_root = RegisterType(clang_getCursorType(cursor));
+		node.unqualified_root = RegisterType(context, clang_getCursorType(cursor));
+		node.usr = GetCXCursorUSR(context, cursor);
 	}
 	else
 	{
-		node.unqualified_root = RegisterType(clang_getUnqualifiedType(cx_type));
+		node.unqualified_root = RegisterType(context, clang_getUnqualifiedType(cx_type));
 	}
 
 	if (cx_type.kind == CXType_LValueReference || cx_type.kind == CXType_RValueReference)
 	{
 		// Resolve reference
 		cx_type = clang_getNonReferenceType(cx_type);
-		node.pointee = RegisterType(cx_type);
+		node.pointee = RegisterType(context, cx_type);
 	}
 	else if (cx_type.kind == CXType_Pointer || cx_type.kind == CXType_BlockPointer || cx_type.kind == CXType_ObjCObjectPointer || cx_type.kind == CXType_MemberPointer /* || cx_type.kind == CXType_Auto || cx_type.kind == CXType_DeducedTemplateSpecialization*/)
 	{
@@ -361,437 +419,607 @@ std::string RegisterType(CXType cx_type)
 		if (cx_try.kind != CXType_Invalid)
 		{
 			cx_type = cx_try;
-			node.pointee = RegisterType(cx_type);
+			node.pointee = RegisterType(context, cx_type);
 		}
 	}
 
-	// Get template parameters
+	// Get template arguments
+	// Qualified, pointer and reference variants of a specialization share the arguments of its unqualified type, so they're only walked once
 	if (!clang_isInvalid(cursor.kind))
 	{
-		int template_num = clang_Cursor_getNumTemplateArguments(cursor);
-
-		if (template_num >= 0)
+		const TypeNode &root_node = context.types[node.unqualified_root];
+		if (node.unqualified_root != id && root_node.id != InvalidTypeId)
 		{
-			node.is_template = true;
+			node.is_template = root_node.is_template;
+			node.template_args = root_node.template_args;
+			node.template_name = root_node.template_name;
+		}
+		else
+		{
+			int template_num = clang_Cursor_getNumTemplateArguments(cursor);
 
-			for (unsigned int t = 0; t < template_num; t++)
+			if (template_num >= 0)
 			{
-				TypeNode::TemplateArg arg;
+				node.is_template = true;
 
-				auto t_kind = clang_Cursor_getTemplateArgumentKind(cursor, t);
-				switch (t_kind)
+				CXCursor template_cursor = clang_getSpecializedCursorTemplate(cursor);
+				if (!clang_Cursor_isNull(template_cursor))
+					node.template_name = GetCXCursorName(context, template_cursor);
+
+				for (unsigned int t = 0; t < template_num; t++)
 				{
-					case CXTemplateArgumentKind_Type:
-						arg.arg_type = TypeNode::TemplateArg::TemplateArgType::Type;
-						arg.type = RegisterType(clang_Cursor_getTemplateArgumentType(cursor, t));
-						break;
-					case CXTemplateArgumentKind_NullPtr:
-						arg.arg_type = TypeNode::TemplateArg::TemplateArgType::Nullptr;
-						break;
-					case CXTemplateArgumentKind_Integral:
-						arg.arg_type = TypeNode::TemplateArg::TemplateArgType::Integral;
-						arg.integral = clang_Cursor_getTemplateArgumentValue(cursor, t);
-						break;
-					case CXTemplateArgumentKind_Null:
-						throw std::runtime_error("CXTemplateArgumentKind_Null: " + name);
-					case CXTemplateArgumentKind_Declaration:
-						throw std::runtime_error("CXTemplateArgumentKind_Declaration: " + name);
-					case CXTemplateArgumentKind_Template:
-						throw std::runtime_error("CXTemplateArgumentKind_Template: " + name);
-					case CXTemplateArgumentKind_TemplateExpansion:
-						throw std::runtime_error("CXTemplateArgumentKind_TemplateExpansion: " + name);
-					case CXTemplateArgumentKind_Expression:
-						throw std::runtime_error("CXTemplateArgumentKind_Expression: " + name);
-					case CXTemplateArgumentKind_Pack:
-						throw std::runtime_error("CXTemplateArgumentKind_Pack: " + name);
-					case CXTemplateArgumentKind_Invalid:
-						throw std::runtime_error("Could not deduce template argument type: " + name);
+					TypeNode::TemplateArg arg;
+
+					auto t_kind = clang_Cursor_getTemplateArgumentKind(cursor, t);
+					switch (t_kind)
+					{
+						case CXTemplateArgumentKind_Type:
+							arg.arg_type = TypeNode::TemplateArg::TemplateArgType::Type;
+							arg.type = RegisterType(context, clang_Cursor_getTemplateArgumentType(cursor, t));
+							break;
+						case CXTemplateArgumentKind_NullPtr:
+							arg.arg_type = TypeNode::TemplateArg::TemplateArgType::Nullptr;
+							break;
+						case CXTemplateArgumentKind_Integral:
+							arg.arg_type = TypeNode::TemplateArg::TemplateArgType::Integral;
+							arg.integral = clang_Cursor_getTemplateArgumentValue(cursor, t);
+							break;
+						case CXTemplateArgumentKind_Null:
+							throw std::runtime_error("CXTemplateArgumentKind_Null: " + name);
+						case CXTemplateArgumentKind_Declaration:
+							throw std::runtime_error("CXTemplateArgumentKind_Declaration: " + name);
+						case CXTemplateArgumentKind_Template:
+							throw std::runtime_error("CXTemplateArgumentKind_Template: " + name);
+						case CXTemplateArgumentKind_TemplateExpansion:
+							throw std::runtime_error("CXTemplateArgumentKind_TemplateExpansion: " + name);
+						case CXTemplateArgumentKind_Expression:
+							throw std::runtime_error("CXTemplateArgumentKind_Expression: " + name);
+						case CXTemplateArgumentKind_Pack:
+							throw std::runtime_error("CXTemplateArgumentKind_Pack: " + name);
+						case CXTemplateArgumentKind_Invalid:
+							throw std::runtime_error("Could not deduce template argument type: " + name);
+					}
+
+					node.template_args.emplace_back(std::move(arg));
 				}
+			}
+		}
+	}
+
+	context.types[id] = std::move(node);
+	return id;
+}
 
-				node.template_args.emplace_back(std::move(arg));
+// Get the type of a declaration as it was written
+// Taken from the declaration's tokens up to its name, leaving out specifiers and attributes
+static std::string GetWrittenTypeName(CXCursor decl)
+{
+	CXTranslationUnit tu = clang_Cursor_getTranslationUnit(decl);
+	std::string decl_name = GetCXString(clang_getCursorSpelling(decl));
+
+	CXToken *tokens = nullptr;
+	unsigned int num_tokens = 0;
+	clang_tokenize(tu, clang_getCursorExtent(decl), &tokens, &num_tokens);
+
+	std::vector<std::pair<CXTokenKind, std::string>> spellings;
+	for (unsigned int i = 0; i < num_tokens; i++)
+		spellings.emplace_back(clang_getTokenKind(tokens[i]), GetCXString(clang_getTokenSpelling(tu, tokens[i])));
+	clang_disposeTokens(tu, tokens, num_tokens);
+
+	std::string name;
+	bool last_word = false;
+
+	for (size_t i = 0; i < spellings.size(); i++)
+	{
+		auto &[kind, spelling] = spellings[i];
+
+		// The type ends at the declaration's name
+		if (kind == CXToken_Identifier && spelling == decl_name)
+			break;
+		if (kind == CXToken_Keyword && spelling == "operator")
+			break;
+		if (kind == CXToken_Punctuation && (spelling == "(" || spelling == "[" || spelling == "=" || spelling == ";" || spelling == "{" || spelling == ":"))
+			break;
+
+		// Skip specifiers
+		if (kind == CXToken_Keyword && (spelling == "static" || spelling == "inline" || spelling == "virtual" || spelling == "constexpr" || spelling == "consteval" || spelling == "constinit" || spelling == "mutable" || spelling == "explicit" || spelling == "extern" || spelling == "friend" || spelling == "typename"))
+			continue;
+
+		// Skip attributes, along with their arguments
+		if (kind == CXToken_Identifier && (spelling.rfind("LEON", 0) == 0 || spelling == "__attribute__"))
+		{
+			if (i + 1 < spellings.size() && spellings[i + 1].second == "(")
+			{
+				int depth = 0;
+				for (i++; i < spellings.size(); i++)
+				{
+					if (spellings[i].second == "(")
+						depth++;
+					else if (spellings[i].second == ")" && --depth == 0)
+						break;
+				}
 			}
+			continue;
 		}
+
+		// Space out words, and references and pointers like GetCXTypeName
+		bool word = (kind == CXToken_Identifier || kind == CXToken_Keyword);
+		if (!name.empty() && ((word && last_word) || spelling == "*" || spelling == "&" || spelling == "&&" || name.back() == ','))
+			name += ' ';
+
+		name += spelling;
+		last_word = word;
 	}
 
 	return name;
 }
 
-// Enum registry
-std::unordered_map<std::string, EnumNode> enum_nodes;
+// Register a type that couldn't be resolved
+static TypeId RegisterOpaqueType(Context &context, const std::string &name)
+{
+	auto it = context.type_ids.find(name);
+	if (it != context.type_ids.end())
+		return it->second;
+
+	TypeId id = static_cast<TypeId>(context.types.size());
+	TypeNode &node = context.types.emplace_back(&context.arena);
+
+	node.id = id;
+	node.name = context.Intern(name);
+	node.type = TypeNode::Type::Type;
+	node.root = id;
+	node.unqualified_root = id;
+	node.unqualified = id;
+	node.opaque = true;
+
+	context.type_ids.emplace(node.name, id);
+	return id;
+}
 
-static std::string RegisterEnum(CXCursor cursor)
+// Register the type of a declaration
+// In a lenient parse, a declaration whose type couldn't be resolved gets an opaque type named as written
+static TypeId RegisterDeclType(Context &context, CXCursor decl, CXType cx_type)
 {
-	std::string name = GetCXCursorName(cursor);
+	if (!context.lenient)
+		return RegisterType(context, cx_type);
+
+	// Clang recovers unknown types as int, but marks the declaration invalid
+	if (!clang_isInvalidDeclaration(decl))
+	{
+		// The full name is built before anything is registered, so a failure leaves the registry as it was
+		try
+		{
+			return RegisterType(context, cx_type);
+		}
+		catch (std::runtime_error &)
+		{
+		}
+	}
+
+	return RegisterOpaqueType(context, GetWrittenTypeName(decl));
+}
+
+// Get the visibility of a member cursor
+static ClassNode::Visibility GetVisibility(CXCursor cursor, const char *what)
+{
+	auto access = clang_getCXXAccessSpecifier(cursor);
+	switch (access)
+	{
+		case CX_CXXPublic:
+			return ClassNode::Visibility::Public;
+		case CX_CXXProtected:
+			return ClassNode::Visibility::Protected;
+		case CX_CXXPrivate:
+			return ClassNode::Visibility::Private;
+		default:
+			throw std::runtime_error(std::string("Unexpected access specifier for ") + what);
+	}
+}
+
+// Enum registry
+// Attributes are always the first children of a declaration, so an enum without any is left after its first other child
+static std::string_view RegisterEnum(Context &context, CXCursor cursor)
+{
+	std::string_view name = GetCXCursorName(context, cursor);
 
 	// Check if enum was already registered
-	auto it = enum_nodes.find(name);
-	if (it != enum_nodes.end())
+	auto it = context.enum_nodes.find(name);
+	if (it != context.enum_nodes.end())
 		return it->first;
 
 	// Visit enum children
 	struct VisitorClient
 	{
-		EnumNode node;
-		std::string last_elem;
-		long long current_value = 0;
-	} client;
+		Context &context;
+		CXCursor cursor;
 
-	client.node.attrs = ParseCXCursorAttributes(cursor);
+		EnumNode node{&context.arena};
+		std::string_view last_elem = {};
+		long long current_value = 0;
+	} client{context, cursor};
 
-	if (client.node.attrs.size())
-	{
-		client.node.name = name;
+	auto visitor = [](CXCursor cursor, CXCursor parent, CXClientData clientData) -> CXChildVisitResult
+		{
+			auto &client = *(reinterpret_cast<VisitorClient *>(clientData));
+			client.context.cursor_visits++;
 
-		auto visitor = [](CXCursor cursor, CXCursor parent, CXClientData clientData) -> CXChildVisitResult
+			// Enum attributes
+			if (cursor.kind == CXCursor_AnnotateAttr)
 			{
-				auto &client = *(reinterpret_cast<VisitorClient *>(clientData));
+				if (clang_equalCursors(parent, client.cursor))
+					AddAttribute(client.context, client.node.attrs, cursor);
+				return CXChildVisit_Continue;
+			}
 
-				// Start enum element
-				if (cursor.kind == CXCursor_EnumConstantDecl)
-				{
-					std::string name = GetCXString(clang_getCursorSpelling(cursor));
-					client.last_elem = name;
-					client.node.elems[name] = client.current_value++;
-					return CXChildVisit_Recurse;
-				}
+			if (client.node.attrs.empty())
+				return CXChildVisit_Break;
+
+			// Start enum element
+			if (cursor.kind == CXCursor_EnumConstantDecl)
+			{
+				std::string_view name = client.context.Intern(GetCXString(clang_getCursorSpelling(cursor)));
+				client.last_elem = name;
+				client.node.elems[name] = client.current_value++;
+				return CXChildVisit_Recurse;
+			}
 
-				// Evaluate operators
-				CXEvalResult result = clang_Cursor_Evaluate(cursor);
-				if (result != nullptr)
+			// Evaluate operators
+			CXEvalResult result = clang_Cursor_Evaluate(cursor);
+			if (result != nullptr)
+			{
+				CXEvalResultKind result_kind = clang_EvalResult_getKind(result);
+				switch (result_kind)
 				{
-					CXEvalResultKind result_kind = clang_EvalResult_getKind(result);
-					switch (result_kind)
+					case CXEval_Int:
 					{
-						case CXEval_Int:
-						{
-							long long value = clang_EvalResult_getAsLongLong(result);
-							client.node.elems[client.last_elem] = value;
-							client.current_value = value + 1;
-							break;
-						}
-						default:
-						{
-							throw std::runtime_error("Unexpected EvalResult kind for enum element");
-						}
+						long long value = clang_EvalResult_getAsLongLong(result);
+						client.node.elems[client.last_elem] = value;
+						client.current_value = value + 1;
+						break;
+					}
+					default:
+					{
+						throw std::runtime_error("Unexpected EvalResult kind for enum element");
 					}
 				}
+			}
 
-				return CXChildVisit_Continue;
-			};
+			return CXChildVisit_Continue;
+		};
 
-		clang_visitChildren(cursor, visitor, &client);
+	clang_visitChildren(cursor, visitor, &client);
 
-		enum_nodes[name] = std::move(client.node);
+	if (client.node.attrs.size())
+	{
+		client.node.name = name;
+		client.node.usr = GetCXCursorUSR(context, cursor);
+		context.enum_nodes.emplace(name, std::move(client.node));
 	}
 
 	return "";
 }
 
 // Class registry
-std::unordered_map<std::string, ClassNode> class_nodes;
-
-std::string RegisterClass(CXCursor cursor)
+// The class is walked once, with each member's attributes read as its first children.
+// Members are only registered once their attributes are known, the rest of an unannotated member's children are skipped over.
+static std::string_view RegisterClass(Context &context, CXCursor cursor)
 {
-	std::string name = GetCXCursorName(cursor);
+	// Explicit specializations are named with their arguments, apart from their template
+	std::string_view name = GetCXSpecializationName(context, cursor);
 
 	// Check if class was already registered
-	auto it = class_nodes.find(name);
-	if (it != class_nodes.end())
+	auto it = context.class_nodes.find(name);
+	if (it != context.class_nodes.end())
 		return it->first;
 
 	struct VisitorClient
 	{
-		ClassNode node;
-		int friend_decl = 0;
+		Context &context;
+		CXCursor cursor;
+		ClassNode node{&context.arena};
 
-		ClassNode::Method *current_method = nullptr;
-		ClassNode::Method::Arg *current_arg = nullptr;
-	} client;
+		// Member whose attributes are being read
+		CXCursor decl = clang_getNullCursor();
+		bool decl_open = false;
+		bool decl_friend = false;
+		std::pmr::vector<LeonAttr> decl_attrs{&context.arena};
 
-	client.node.attrs = ParseCXCursorAttributes(cursor);
+		// Template parameters, which come before the class's attributes
+		std::vector<CXCursor> template_params = {};
 
-	if (client.node.attrs.size())
-	{
-		client.node.name = name;
+		// Last friend declaration, friend functions are its children
+		CXCursor friend_cursor = clang_getNullCursor();
+
+		// Annotated method whose parameters are being read
+		CXCursor method_cursor = clang_getNullCursor();
+		ClassNode::Method *current_method = nullptr;
 
-		switch (cursor.kind)
+		CXCursor arg_cursor = clang_getNullCursor();
+		ClassNode::Method::Arg *current_arg = nullptr;
+
+		// Register the member once all of its attributes have been read
+		void FinishDecl()
 		{
-			case CXCursor_ClassDecl:
-				client.node.class_type = ClassNode::ClassType::Class;
-				break;
-			case CXCursor_StructDecl:
-				client.node.class_type = ClassNode::ClassType::Struct;
-				break;
-			default:
-				throw std::runtime_error("Unexpected cursor kind for RegisterClass");
-		}
+			decl_open = false;
+			if (decl_attrs.empty())
+				return;
 
-		auto visitor = [](CXCursor cursor, CXCursor parent, CXClientData clientData) -> CXChildVisitResult
+			switch (decl.kind)
 			{
-				auto &client = *(reinterpret_cast<VisitorClient *>(clientData));
+				// Members
+				case CXCursor_FieldDecl:
+				{
+					ClassNode::Member member(&context.arena);
+					member.attrs = std::move(decl_attrs);
+					member.name = context.Intern(GetCXString(clang_getCursorSpelling(decl)));
+					member.visibility = GetVisibility(decl, "member");
+					member.member_type = ClassNode::Member::MemberType::Member;
+					member.type = RegisterDeclType(context, decl, clang_getCursorType(decl));
+
+					node.members.emplace_back(std::move(member));
+					break;
+				}
 
-				if (client.friend_decl)
-					client.friend_decl--;
+				// Variables
+				case CXCursor_VarDecl:
+				{
+					ClassNode::Member member(&context.arena);
+					member.attrs = std::move(decl_attrs);
+					member.name = context.Intern(GetCXString(clang_getCursorSpelling(decl)));
+					member.visibility = GetVisibility(decl, "variable");
+					member.member_type = ClassNode::Member::MemberType::Static;
+					member.type = RegisterDeclType(context, decl, clang_getCursorType(decl));
+
+					node.members.emplace_back(std::move(member));
+					break;
+				}
 
-				// Add base class
-				if (cursor.kind == CXCursor_CXXBaseSpecifier)
+				// Functions
+				case CXCursor_FunctionDecl:
 				{
-					ClassNode::Base base;
+					ClassNode::Method method(&context.arena);
+					method.attrs = std::move(decl_attrs);
+					method.name = context.Intern(GetCXString(clang_getCursorSpelling(decl)));
+					method.visibility = GetVisibility(decl, "function");
+
+					if (decl_friend)
+						method.method_type = ClassNode::Method::MethodType::Friend;
+					else
+						throw std::runtime_error("FunctionDecl in class without FriendDecl");
+
+					method.return_type = RegisterDeclType(context, decl, clang_getCursorResultType(decl));
 
-					auto access = clang_getCXXAccessSpecifier(cursor);
-					switch (access)
+					current_method = &(node.methods.emplace_back(std::move(method)));
+					method_cursor = decl;
+					break;
+				}
+
+				// Methods
+				case CXCursor_CXXMethod:
+				{
+					auto storage = clang_Cursor_getStorageClass(decl);
+
+					ClassNode::Method method(&context.arena);
+					method.attrs = std::move(decl_attrs);
+					method.name = context.Intern(GetCXString(clang_getCursorSpelling(decl)));
+					method.visibility = GetVisibility(decl, "method");
+
+					switch (storage)
 					{
-						case CX_CXXPublic:
-							base.visibility = ClassNode::Visibility::Public;
+						case CX_SC_None:
+							method.method_type = ClassNode::Method::MethodType::Method;
 							break;
-						case CX_CXXProtected:
-							base.visibility = ClassNode::Visibility::Protected;
+						case CX_SC_Static:
+							method.method_type = ClassNode::Method::MethodType::Static;
 							break;
-						case CX_CXXPrivate:
-							base.visibility = ClassNode::Visibility::Private;
+						case CX_SC_Extern:
+						case CX_SC_PrivateExtern:
+						case CX_SC_OpenCLWorkGroupLocal:
+						case CX_SC_Auto:
+						case CX_SC_Register:
+							throw std::runtime_error("Invalid CXXMethod storage class");
 							break;
 						default:
-							throw std::runtime_error("Unexpected access specifier for base specifier");
+							throw std::runtime_error("Unexpected storage class for method");
 					}
 
-					auto type = clang_getCursorType(cursor);
-					if (type.kind == CXType_Invalid)
-						throw std::runtime_error("Type not found for base specifier");
+					method.q_const = clang_CXXMethod_isConst(decl);
+					method.q_virtual = clang_CXXMethod_isVirtual(decl);
+					method.q_pure = clang_CXXMethod_isPureVirtual(decl);
 
-					auto decl = clang_getTypeDeclaration(type);
-					if (clang_isInvalid(decl.kind))
-						throw std::runtime_error("Type not found for base specifier");
+					method.return_type = RegisterDeclType(context, decl, clang_getCursorResultType(decl));
 
-					base.base_class = GetCXCursorName(decl);
+					current_method = &(node.methods.emplace_back(std::move(method)));
+					method_cursor = decl;
+					break;
+				}
 
-					client.node.bases.emplace_back(std::move(base));
+				default:
+					break;
+			}
 
-					return CXChildVisit_Continue;
-				}
+			decl_attrs.clear();
+		}
+	} client{context, cursor};
 
-				// Start nested classes and structs
-				if (cursor.kind == CXCursor_ClassDecl || cursor.kind == CXCursor_StructDecl)
-				{
-					RegisterClass(cursor);
-					return CXChildVisit_Continue;
-				}
+	auto visitor = [](CXCursor cursor, CXCursor parent, CXClientData clientData) -> CXChildVisitResult
+		{
+			auto &client = *(reinterpret_cast<VisitorClient *>(clientData));
+			client.context.cursor_visits++;
 
-				// Start nested enum
-				if (cursor.kind == CXCursor_EnumDecl)
-				{
-					RegisterEnum(cursor);
-					return CXChildVisit_Continue;
-				}
+			// Attach attributes to the declaration they're a child of
+			if (cursor.kind == CXCursor_AnnotateAttr)
+			{
+				if (clang_equalCursors(parent, client.cursor))
+					AddAttribute(client.context, client.node.attrs, cursor);
+				else if (client.decl_open && clang_equalCursors(parent, client.decl))
+					AddAttribute(client.context, client.decl_attrs, cursor);
+				else if (client.current_arg != nullptr && clang_equalCursors(parent, client.arg_cursor))
+					AddAttribute(client.context, client.current_arg->attrs, cursor);
+				return CXChildVisit_Continue;
+			}
 
-				// Members
-				if (cursor.kind == CXCursor_FieldDecl)
-				{
-					auto access = clang_getCXXAccessSpecifier(cursor);
+			// Template parameters, registered once we know the class is annotated
+			if (cursor.kind == CXCursor_TemplateTypeParameter || cursor.kind == CXCursor_NonTypeTemplateParameter || cursor.kind == CXCursor_TemplateTemplateParameter)
+			{
+				if (clang_equalCursors(parent, client.cursor))
+					client.template_params.push_back(cursor);
+				return CXChildVisit_Continue;
+			}
 
-					ClassNode::Member member;
-					member.attrs = ParseCXCursorAttributes(cursor);
+			// The class's own attributes come first, so there's nothing to do without any
+			if (client.node.attrs.empty())
+				return CXChildVisit_Break;
 
-					if (member.attrs.size())
-					{
-						member.name = GetCXString(clang_getCursorSpelling(cursor));
-
-						switch (access)
-						{
-							case CX_CXXPublic:
-								member.visibility = ClassNode::Visibility::Public;
-								break;
-							case CX_CXXProtected:
-								member.visibility = ClassNode::Visibility::Protected;
-								break;
-							case CX_CXXPrivate:
-								member.visibility = ClassNode::Visibility::Private;
-								break;
-							default:
-								throw std::runtime_error("Unexpected access specifier for member");
-						}
-
-						member.member_type = ClassNode::Member::MemberType::Member;
-
-						member.type = RegisterType(clang_getCursorType(cursor));
-
-						client.node.members.emplace_back(std::move(member));
-					}
+			// Anything else ends the attributes of the current member
+			if (client.decl_open)
+				client.FinishDecl();
 
+			// Parameters of an annotated method
+			if (client.current_method != nullptr && clang_equalCursors(parent, client.method_cursor))
+			{
+				if (cursor.kind != CXCursor_ParmDecl)
 					return CXChildVisit_Continue;
-				}
 
-				// Variables
-				if (cursor.kind == CXCursor_VarDecl)
-				{
-					auto access = clang_getCXXAccessSpecifier(cursor);
+				client.current_arg = &(client.current_method->args.emplace_back(&client.context.arena));
+				client.arg_cursor = cursor;
 
-					ClassNode::Member member;
-					member.attrs = ParseCXCursorAttributes(cursor);
+				client.current_arg->name = client.context.Intern(GetCXString(clang_getCursorSpelling(cursor)));
+				client.current_arg->type = RegisterDeclType(client.context, cursor, clang_getCursorType(cursor));
 
-					if (member.attrs.size())
-					{
-						member.name = GetCXString(clang_getCursorSpelling(cursor));
-
-						switch (access)
-						{
-							case CX_CXXPublic:
-								member.visibility = ClassNode::Visibility::Public;
-								break;
-							case CX_CXXProtected:
-								member.visibility = ClassNode::Visibility::Protected;
-								break;
-							case CX_CXXPrivate:
-								member.visibility = ClassNode::Visibility::Private;
-								break;
-							default:
-								throw std::runtime_error("Unexpected access specifier for variable");
-						}
-
-						member.member_type = ClassNode::Member::MemberType::Static;
-
-						member.type = RegisterType(clang_getCursorType(cursor));
-
-						client.node.members.emplace_back(std::move(member));
-					}
+				return CXChildVisit_Recurse;
+			}
 
+			// Friend functions
+			if (clang_equalCursors(parent, client.friend_cursor))
+			{
+				if (cursor.kind != CXCursor_FunctionDecl)
 					return CXChildVisit_Continue;
-				}
 
-				// Functions
-				if (cursor.kind == CXCursor_FunctionDecl)
-				{
-					auto access = clang_getCXXAccessSpecifier(cursor);
-					auto storage = clang_Cursor_getStorageClass(cursor);
+				client.decl = cursor;
+				client.decl_open = true;
+				client.decl_friend = true;
+				return CXChildVisit_Recurse;
+			}
 
-					ClassNode::Method method;
-					method.attrs = ParseCXCursorAttributes(cursor);
+			// Skip the children of anything that isn't a class member
+			if (!clang_equalCursors(parent, client.cursor))
+				return CXChildVisit_Continue;
 
-					if (method.attrs.size())
-					{
-						method.name = GetCXString(clang_getCursorSpelling(cursor));
-
-						switch (access)
-						{
-							case CX_CXXPublic:
-								method.visibility = ClassNode::Visibility::Public;
-								break;
-							case CX_CXXProtected:
-								method.visibility = ClassNode::Visibility::Protected;
-								break;
-							case CX_CXXPrivate:
-								method.visibility = ClassNode::Visibility::Private;
-								break;
-							default:
-								throw std::runtime_error("Unexpected access specifier for function");
-						}
-
-						if (client.friend_decl)
-							method.method_type = ClassNode::Method::MethodType::Friend;
-						else
-							throw std::runtime_error("FunctionDecl in class without FriendDecl");
-
-						method.return_type = RegisterType(clang_getCursorResultType(cursor));
-
-						client.current_method = &(client.node.methods.emplace_back(std::move(method)));
-						client.current_arg = nullptr;
-						return CXChildVisit_Recurse;
-					}
-					else
-					{
-						client.current_method = nullptr;
-						client.current_arg = nullptr;
-						return CXChildVisit_Continue;
-					}
-				}
+			client.current_method = nullptr;
+			client.current_arg = nullptr;
 
-				// Methods
-				if (cursor.kind == CXCursor_CXXMethod)
+			switch (cursor.kind)
+			{
+				// Add base class
+				case CXCursor_CXXBaseSpecifier:
 				{
-					auto access = clang_getCXXAccessSpecifier(cursor);
-					auto storage = clang_Cursor_getStorageClass(cursor);
-
-					ClassNode::Method method;
-					method.attrs = ParseCXCursorAttributes(cursor);
+					ClassNode::Base base;
+					base.visibility = GetVisibility(cursor, "base specifier");
 
-					if (method.attrs.size())
+					auto type = clang_getCursorType(cursor);
+					auto decl = clang_getTypeDeclaration(type);
+					if (type.kind == CXType_Invalid || clang_isInvalid(decl.kind))
 					{
-						method.name = GetCXString(clang_getCursorSpelling(cursor));
-
-						switch (access)
-						{
-							case CX_CXXPublic:
-								method.visibility = ClassNode::Visibility::Public;
-								break;
-							case CX_CXXProtected:
-								method.visibility = ClassNode::Visibility::Protected;
-								break;
-							case CX_CXXPrivate:
-								method.visibility = ClassNode::Visibility::Private;
-								break;
-							default:
-								throw std::runtime_error("Unexpected access specifier for method");
-						}
-
-						switch (storage)
-						{
-							case CX_SC_None:
-								method.method_type = ClassNode::Method::MethodType::Method;
-								break;
-							case CX_SC_Static:
-								method.method_type = ClassNode::Method::MethodType::Static;
-								break;
-							case CX_SC_Extern:
-							case CX_SC_PrivateExtern:
-							case CX_SC_OpenCLWorkGroupLocal:
-							case CX_SC_Auto:
-							case CX_SC_Register:
-								throw std::runtime_error("Invalid CXXMethod storage class");
-								break;
-							default:
-								throw std::runtime_error("Unexpected storage class for method");
-						}
-
-						method.q_const = clang_CXXMethod_isConst(cursor);
-						method.q_virtual = clang_CXXMethod_isVirtual(cursor);
-						method.q_pure = clang_CXXMethod_isPureVirtual(cursor);
-
-						method.return_type = RegisterType(clang_getCursorResultType(cursor));
-
-						client.current_method = &(client.node.methods.emplace_back(std::move(method)));
-						client.current_arg = nullptr;
-						return CXChildVisit_Recurse;
+						if (!client.context.lenient)
+							throw std::runtime_error("Type not found for base specifier");
+
+						// Name the base as written
+						base.base_class = client.context.Intern(GetCXString(clang_getCursorSpelling(cursor)));
 					}
 					else
 					{
-						client.current_method = nullptr;
-						client.current_arg = nullptr;
-						return CXChildVisit_Continue;
+						base.base_class = GetCXCursorName(client.context, decl);
 					}
+
+					client.node.bases.emplace_back(std::move(base));
+					return CXChildVisit_Continue;
 				}
 
-				// Parameters
-				if (cursor.kind == CXCursor_ParmDecl)
-				{
-					if (client.current_method == nullptr)
-						throw std::runtime_error("ParmDecl without CXXMethod or FunctionDecl");
-					client.current_arg = &(client.current_method->args.emplace_back());
+				// Start nested classes, structs and class templates
+				case CXCursor_ClassDecl:
+				case CXCursor_StructDecl:
+				case CXCursor_ClassTemplate:
+					RegisterClass(client.context, cursor);
+					return CXChildVisit_Continue;
 
-					client.current_arg->name = GetCXString(clang_getCursorSpelling(cursor));
-					client.current_arg->type = RegisterType(clang_getCursorType(cursor));
+				// Start nested enum
+				case CXCursor_EnumDecl:
+					RegisterEnum(client.context, cursor);
+					return CXChildVisit_Continue;
 
-					client.current_arg->attrs = ParseCXCursorAttributes(cursor);
+				// Start reading member attributes
+				case CXCursor_FieldDecl:
+				case CXCursor_VarDecl:
+				case CXCursor_FunctionDecl:
+				case CXCursor_CXXMethod:
+					client.decl = cursor;
+					client.decl_open = true;
+					client.decl_friend = false;
+					return CXChildVisit_Recurse;
 
+				// Friend declarations contain the friend function
+				case CXCursor_FriendDecl:
+					client.friend_cursor = cursor;
+					return CXChildVisit_Recurse;
+
+				default:
 					return CXChildVisit_Continue;
-				}
+			}
+		};
 
-				// Update friend decl
-				if (cursor.kind == CXCursor_FriendDecl)
-					client.friend_decl = 2;
+	clang_visitChildren(cursor, visitor, &client);
 
-				return CXChildVisit_Recurse;
-			};
+	if (client.node.attrs.size())
+	{
+		// The last member may not have had any children to end its attributes
+		if (client.decl_open)
+			client.FinishDecl();
+
+		client.node.name = name;
+		client.node.usr = GetCXCursorUSR(context, cursor);
+
+		// A class template is reflected once, its specializations are types naming it as their template
+		CXCursorKind class_kind = cursor.kind;
+		if (cursor.kind == CXCursor_ClassTemplate)
+		{
+			class_kind = clang_getTemplateCursorKind(cursor);
+			client.node.is_template = true;
+
+			for (auto &i : client.template_params)
+			{
+				ClassNode::TemplateParam param;
+				param.name = context.Intern(GetCXString(clang_getCursorSpelling(i)));
+
+				switch (i.kind)
+				{
+					case CXCursor_TemplateTypeParameter:
+						param.param_type = ClassNode::TemplateParam::ParamType::Type;
+						break;
+					case CXCursor_NonTypeTemplateParameter:
+						param.param_type = ClassNode::TemplateParam::ParamType::NonType;
+						param.type = RegisterDeclType(context, i, clang_getCursorType(i));
+						break;
+					default:
+						param.param_type = ClassNode::TemplateParam::ParamType::Template;
+						break;
+				}
 
-		clang_visitChildren(cursor, visitor, &client);
+				client.node.template_params.push_back(param);
+			}
+		}
+
+		switch (class_kind)
+		{
+			case CXCursor_ClassDecl:
+				client.node.class_type = ClassNode::ClassType::Class;
+				break;
+			case CXCursor_StructDecl:
+				client.node.class_type = ClassNode::ClassType::Struct;
+				break;
+			default:
+				throw std::runtime_error("Unexpected cursor kind for RegisterClass");
+		}
 
 		// Determine if this is an abstract class
 		client.node.q_abstract = false;
@@ -801,121 +1029,285 @@ std::string RegisterClass(CXCursor cursor)
 				client.node.q_abstract = true;
 		}
 
-		class_nodes[name] = std::move(client.node);
+		context.class_nodes.emplace(name, std::move(client.node));
 	}
 
 	return name;
 }
 
 // Function registry
-std::unordered_map<std::string, FunctionNode> function_nodes;
-
-static std::string RegisterFunction(CXCursor cursor)
+static std::string_view RegisterFunction(Context &context, CXCursor cursor)
 {
-	std::string name = GetCXCursorName(cursor);
+	std::string_view name = GetCXCursorName(context, cursor);
 
 	// Check if class was already registered
-	auto it = class_nodes.find(name);
-	if (it != class_nodes.end())
+	auto it = context.class_nodes.find(name);
+	if (it != context.class_nodes.end())
 		return it->first;
 
 	struct VisitorClient
 	{
-		FunctionNode node;
+		Context &context;
+		CXCursor cursor;
+		FunctionNode node{&context.arena};
+		bool started = false;
 
+		CXCursor arg_cursor = clang_getNullCursor();
 		FunctionNode::Arg *current_arg = nullptr;
-	} client;
 
-	client.node.attrs = ParseCXCursorAttributes(cursor);
-
-	if (client.node.attrs.size())
-	{
-		client.node.name = name;
+		// Registered once the function's attributes are known
+		void Start()
+		{
+			started = true;
+			node.return_type = RegisterDeclType(context, cursor, clang_getCursorResultType(cursor));
+		}
+	} client{context, cursor};
 
-		client.node.return_type = RegisterType(clang_getCursorResultType(cursor));
+	auto visitor = [](CXCursor cursor, CXCursor parent, CXClientData clientData) -> CXChildVisitResult
+		{
+			auto &client = *(reinterpret_cast<VisitorClient *>(clientData));
+			client.context.cursor_visits++;
 
-		auto visitor = [](CXCursor cursor, CXCursor parent, CXClientData clientData) -> CXChildVisitResult
+			// Attach attributes to the function or parameter
+			if (cursor.kind == CXCursor_AnnotateAttr)
 			{
-				auto &client = *(reinterpret_cast<VisitorClient *>(clientData));
-
-				// Parameters
-				if (cursor.kind == CXCursor_ParmDecl)
-				{
-					client.current_arg = &(client.node.args.emplace_back());
+				if (clang_equalCursors(parent, client.cursor))
+					AddAttribute(client.context, client.node.attrs, cursor);
+				else if (client.current_arg != nullptr && clang_equalCursors(parent, client.arg_cursor))
+					AddAttribute(client.context, client.current_arg->attrs, cursor);
+				return CXChildVisit_Continue;
+			}
 
-					client.current_arg->name = GetCXString(clang_getCursorSpelling(cursor));
-					client.current_arg->type = RegisterType(clang_getCursorType(cursor));
+			if (client.node.attrs.empty())
+				return CXChildVisit_Break;
+			if (!client.started)
+				client.Start();
 
-					client.current_arg->attrs = ParseCXCursorAttributes(cursor);
+			// Parameters
+			if (cursor.kind == CXCursor_ParmDecl && clang_equalCursors(parent, client.cursor))
+			{
+				client.current_arg = &(client.node.args.emplace_back(&client.context.arena));
+				client.arg_cursor = cursor;
 
-					return CXChildVisit_Continue;
-				}
+				client.current_arg->name = client.context.Intern(GetCXString(clang_getCursorSpelling(cursor)));
+				client.current_arg->type = RegisterDeclType(client.context, cursor, clang_getCursorType(cursor));
 
 				return CXChildVisit_Recurse;
-			};
+			}
 
-		clang_visitChildren(cursor, visitor, &client);
+			return CXChildVisit_Continue;
+		};
+
+	clang_visitChildren(cursor, visitor, &client);
+
+	if (client.node.attrs.size())
+	{
+		if (!client.started)
+			client.Start();
 
-		function_nodes[name] = std::move(client.node);
+		client.node.name = name;
+		context.function_nodes.emplace(name, std::move(client.node));
 	}
 
 	return name;
 }
 
-// Reset
-void Reset()
+// Register a declaration
+// Returns false if the cursor isn't a declaration we register, and its children should be visited instead
+static bool RegisterDeclaration(Context &context, CXCursor cursor)
 {
-	type_nodes.clear();
-	enum_nodes.clear();
-	class_nodes.clear();
-	function_nodes.clear();
+	// Partial specializations share their template's name, only the primary template is reflected
+	if (cursor.kind == CXCursor_ClassTemplatePartialSpecialization)
+		return true;
+
+	if (cursor.kind == CXCursor_ClassDecl || cursor.kind == CXCursor_StructDecl || cursor.kind == CXCursor_ClassTemplate)
+	{
+		RegisterClass(context, cursor);
+		return true;
+	}
+
+	if (cursor.kind == CXCursor_EnumDecl)
+	{
+		RegisterEnum(context, cursor);
+		return true;
+	}
+
+	if (cursor.kind == CXCursor_FunctionDecl)
+	{
+		RegisterFunction(context, cursor);
+		return true;
+	}
+
+	return false;
 }
 
 // Visitor
 CXChildVisitResult Visitor(CXCursor cursor, CXCursor parent, CXClientData clientData)
 {
+	auto &context = *(reinterpret_cast<Context *>(clientData));
+	context.cursor_visits++;
+
 	CXSourceLocation location = clang_getCursorLocation(cursor);
 
 	if (!clang_Location_isFromMainFile(location))
 		return CXChildVisit_Continue;
 
-	unsigned int level_current = *(reinterpret_cast<unsigned int *>(clientData));
-	unsigned int level_next = level_current + 1;
-	std::string level_string = std::string(level_current, '-');
+	if (!RegisterDeclaration(context, cursor))
+		clang_visitChildren(cursor, Visitor, &context);
 
-	if (cursor.kind == CXCursor_ClassTemplate)
-	{
-		// TODO
+	return CXChildVisit_Continue;
+}
+
+// Selecting visitor
+struct SelectClient
+{
+	const ContextSelector &select;
+
+	// Consecutive cursors are almost always from the same file
+	CXFile last_file = nullptr;
+	Context *last_context = nullptr;
+};
+
+static CXChildVisitResult SelectVisitor(CXCursor cursor, CXCursor parent, CXClientData clientData)
+{
+	auto &client = *(reinterpret_cast<SelectClient *>(clientData));
+
+	CXFile file;
+	clang_getExpansionLocation(clang_getCursorLocation(cursor), &file, nullptr, nullptr, nullptr);
+	if (file == nullptr)
 		return CXChildVisit_Continue;
-	}
 
-	if (cursor.kind == CXCursor_ClassTemplatePartialSpecialization)
+	if (client.last_file == nullptr || !clang_File_isEqual(file, client.last_file))
 	{
-		// TODO
-		return CXChildVisit_Continue;
+		client.last_file = file;
+		client.last_context = client.select(file);
 	}
 
-	if (cursor.kind == CXCursor_ClassDecl || cursor.kind == CXCursor_StructDecl)
-	{
-		RegisterClass(cursor);
+	if (client.last_context == nullptr)
 		return CXChildVisit_Continue;
-	}
+	client.last_context->cursor_visits++;
 
-	if (cursor.kind == CXCursor_EnumDecl)
+	if (!RegisterDeclaration(*client.last_context, cursor))
+		clang_visitChildren(cursor, SelectVisitor, &client);
+
+	return CXChildVisit_Continue;
+}
+
+void VisitTranslationUnit(CXTranslationUnit tu, const ContextSelector &select)
+{
+	SelectClient client{ select };
+	clang_visitChildren(clang_getTranslationUnitCursor(tu), SelectVisitor, &client);
+}
+
+// Find the template declaring a templated declaration among the children of its container
+// The template shares the templated declaration's location
+static CXCursor FindTemplateCursor(CXCursor container, CXCursor templated)
+{
+	struct FindClient
 	{
-		RegisterEnum(cursor);
-		return CXChildVisit_Continue;
+		CXSourceLocation location;
+		CXCursor found;
+	} client{clang_getCursorLocation(templated), clang_getNullCursor()};
+
+	clang_visitChildren(container, [](CXCursor cursor, CXCursor, CXClientData client_data) -> CXChildVisitResult
+		{
+			auto &client = *(reinterpret_cast<FindClient *>(client_data));
+			if (!clang_equalLocations(clang_getCursorLocation(cursor), client.location))
+				return CXChildVisit_Continue;
+
+			client.found = cursor;
+			return CXChildVisit_Break;
+		}, &client);
+
+	return client.found;
+}
+
+void IndexDeclaration(Context &context, const CXIdxDeclInfo *info)
+{
+	context.cursor_visits++;
+
+	if (info->isImplicit || info->lexicalContainer == nullptr)
+		return;
+	if (!clang_Location_isFromMainFile(clang_indexLoc_getCXSourceLocation(info->loc)))
+		return;
+
+	// The visitor only steps into namespaces and linkage specs
+	switch (info->lexicalContainer->cursor.kind)
+	{
+		case CXCursor_TranslationUnit:
+		case CXCursor_Namespace:
+		case CXCursor_LinkageSpec:
+			break;
+		default:
+			return;
 	}
 
-	if (cursor.kind == CXCursor_FunctionDecl)
+	// Templates are indexed as the declaration they template, but registered through the template like the visitor does
+	// That way class templates get their parameters, and function templates are skipped
+	CXCursor cursor = info->cursor;
+	if (info->entityInfo->templateKind == CXIdxEntity_Template)
 	{
-		RegisterFunction(cursor);
-		return CXChildVisit_Continue;
+		cursor = FindTemplateCursor(info->lexicalContainer->cursor, info->cursor);
+		if (clang_Cursor_isNull(cursor))
+			return;
 	}
 
-	clang_visitChildren(cursor, Visitor, &level_next);
+	RegisterDeclaration(context, cursor);
+}
 
-	return CXChildVisit_Continue;
+// Translation unit checks
+void CheckTranslationUnit(CXTranslationUnit tu, CXErrorCode ec, std::ostream &diagnostics, bool lenient)
+{
+	// Check diagnostics
+	size_t num_diagnostics = clang_getNumDiagnostics(tu);
+	for (unsigned int i = 0; i < num_diagnostics; i++)
+	{
+		auto diagnostic = clang_getDiagnostic(tu, i);
+		auto severity = clang_getDiagnosticSeverity(diagnostic);
+		if (lenient && severity == CXDiagnostic_Error)
+			severity = CXDiagnostic_Ignored;
+
+		switch (severity)
+		{
+			case CXDiagnostic_Ignored:
+				break;
+			case CXDiagnostic_Note:
+			case CXDiagnostic_Warning:
+			case CXDiagnostic_Error:
+			case CXDiagnostic_Fatal:
+				diagnostics << GetCXString(clang_formatDiagnostic(diagnostic, clang_defaultDiagnosticDisplayOptions())) << '\n';
+				break;
+		}
+		clang_disposeDiagnostic(diagnostic);
+
+		if (severity == CXDiagnostic_Error || severity == CXDiagnostic_Fatal)
+			throw std::runtime_error("Source parsing ran into a fatal error. See above.");
+	}
+
+	// Check if the translation unit failed, but wasn't caught by a diagnostic
+	if (ec != CXError_Success)
+	{
+		std::string problem;
+		switch (ec)
+		{
+			case CXError_Failure:
+				problem = "Failure";
+				break;
+			case CXError_Crashed:
+				problem = "Crashed";
+				break;
+			case CXError_InvalidArguments:
+				problem = "Invalid Arguments";
+				break;
+			case CXError_ASTReadError:
+				problem = "AST Read Error";
+				break;
+			default:
+				problem = std::to_string(ec);
+				break;
+		}
+		throw std::runtime_error(problem + " wasn't caught by a diagnostic.");
+	}
 }
 
 }
@@ -24,10 +24,15 @@
 
 #include <clang-c/Index.h>
 
+#include <cstdint>
 #include <istream>
+#include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
+#include <functional>
+#include <memory_resource>
 
 namespace Leon
 {
@@ -189,9 +194,14 @@ struct LeonAttr
 		KeyValue,
 	} type = Type::Invalid;
 
-	std::pair<std::string, std::string> kv;
+	std::pair<std::string_view, std::string_view> kv;
 };
 
+// Type IDs
+// Types are interned once per context, and referred to by their index into Context::types
+typedef uint32_t TypeId;
+constexpr TypeId InvalidTypeId = UINT32_MAX;
+
 // Type registry
 struct TypeNode
 {
@@ -207,14 +217,15 @@ struct TypeNode
 		MemberPointer,
 	} type = Type::Invalid;
 
-	std::string name;
+	TypeId id = InvalidTypeId;
+	std::string_view name;
 
 	bool q_const = false, q_volatile = false, q_restrict = false;
 
-	std::string root;
-	std::string unqualified_root;
-	std::string unqualified;
-	std::string pointee;
+	TypeId root = InvalidTypeId;
+	TypeId unqualified_root = InvalidTypeId;
+	TypeId unqualified = InvalidTypeId;
+	TypeId pointee = InvalidTypeId;
 
 	struct TemplateArg
 	{
@@ -226,25 +237,36 @@ struct TypeNode
 			Integral,
 		} arg_type = TemplateArgType::Invalid;
 
-		std::string type;
+		TypeId type = InvalidTypeId;
 		long long integral = 0;
 	};
 
 	bool is_template = false;
-	std::vector<TemplateArg> template_args;
-};
+	std::pmr::vector<TemplateArg> template_args;
+
+	// Full name of the template this is a specialization of, the class it names if that template was registered
+	std::string_view template_name;
+
+	// Couldn't be resolved in a lenient parse, only the name as written is known
+	bool opaque = false;
 
-extern std::unordered_map<std::string, TypeNode> type_nodes;
+	// Clang's USR of the class or enum the type names, empty for any other type
+	// Unlike names, USRs identify a declaration across translation units
+	std::string_view usr;
+
+	explicit TypeNode(std::pmr::memory_resource *arena) : template_args(arena) {}
+};
 
 // Enum registry
 struct EnumNode
 {
-	std::string name;
-	std::vector<LeonAttr> attrs;
-	std::unordered_map<std::string, long long> elems;
-};
+	std::string_view name;
+	std::string_view usr;
+	std::pmr::vector<LeonAttr> attrs;
+	std::pmr::unordered_map<std::string_view, long long> elems;
 
-extern std::unordered_map<std::string, EnumNode> enum_nodes;
+	explicit EnumNode(std::pmr::memory_resource *arena) : attrs(arena), elems(arena) {}
+};
 
 // Class registry
 struct ClassNode
@@ -257,7 +279,8 @@ struct ClassNode
 		Private,
 	};
 
-	std::string name;
+	std::string_view name;
+	std::string_view usr;
 	enum class ClassType
 	{
 		Invalid,
@@ -265,21 +288,40 @@ struct ClassNode
 		Class,
 	} class_type = ClassType::Invalid;
 
-	std::vector<LeonAttr> attrs;
+	std::pmr::vector<LeonAttr> attrs;
 
 	bool q_abstract = false;
 
+	// Template parameters of a class template
+	struct TemplateParam
+	{
+		std::string_view name;
+		enum class ParamType
+		{
+			Invalid,
+			Type,
+			NonType,
+			Template,
+		} param_type = ParamType::Invalid;
+
+		// Type of a non-type parameter
+		TypeId type = InvalidTypeId;
+	};
+
+	bool is_template = false;
+	std::pmr::vector<TemplateParam> template_params;
+
 	struct Base
 	{
-		std::string base_class;
+		std::string_view base_class;
 		Visibility visibility = Visibility::Invalid;
 	};
 	
-	std::vector<Base> bases;
+	std::pmr::vector<Base> bases;
 
 	struct Member
 	{
-		std::string name;
+		std::string_view name;
 		enum class MemberType
 		{
 			Invalid,
@@ -287,17 +329,19 @@ struct ClassNode
 			Static,
 		} member_type = MemberType::Invalid;
 
-		std::vector<LeonAttr> attrs;
+		std::pmr::vector<LeonAttr> attrs;
 
 		Visibility visibility = Visibility::Invalid;
 
-		std::string type;
+		TypeId type = InvalidTypeId;
+
+		explicit Member(std::pmr::memory_resource *arena) : attrs(arena) {}
 	};
-	std::vector<Member> members;
+	std::pmr::vector<Member> members;
 
 	struct Method
 	{
-		std::string name;
+		std::string_view name;
 		enum class MethodType
 		{
 			Invalid,
@@ -310,52 +354,158 @@ struct ClassNode
 
 		bool q_virtual = false, q_pure = false;
 
-		std::vector<LeonAttr> attrs;
+		std::pmr::vector<LeonAttr> attrs;
 
 		Visibility visibility = Visibility::Invalid;
 
-		std::string return_type;
+		TypeId return_type = InvalidTypeId;
 
 		struct Arg
 		{
-			std::string type;
-			std::string name;
+			TypeId type = InvalidTypeId;
+			std::string_view name;
 
-			std::vector<LeonAttr> attrs;
+			std::pmr::vector<LeonAttr> attrs;
+
+			explicit Arg(std::pmr::memory_resource *arena) : attrs(arena) {}
 		};
-		std::vector<Arg> args;
+		std::pmr::vector<Arg> args;
+
+		explicit Method(std::pmr::memory_resource *arena) : attrs(arena), args(arena) {}
 	};
-	std::vector<Method> methods;
-};
+	std::pmr::vector<Method> methods;
 
-extern std::unordered_map<std::string, ClassNode> class_nodes;
+	explicit ClassNode(std::pmr::memory_resource *arena) : attrs(arena), template_params(arena), bases(arena), members(arena), methods(arena) {}
+};
 
 // Function registry
 struct FunctionNode
 {
-	std::string name;
+	std::string_view name;
 
-	std::vector<LeonAttr> attrs;
+	std::pmr::vector<LeonAttr> attrs;
 
-	std::string return_type;
+	TypeId return_type = InvalidTypeId;
 
 	struct Arg
 	{
-		std::string type;
-		std::string name;
+		TypeId type = InvalidTypeId;
+		std::string_view name;
+
+		std::pmr::vector<LeonAttr> attrs;
 
-		std::vector<LeonAttr> attrs;
+		explicit Arg(std::pmr::memory_resource *arena) : attrs(arena) {}
 	};
-	std::vector<Arg> args;
+	std::pmr::vector<Arg> args;
+
+	explicit FunctionNode(std::pmr::memory_resource *arena) : attrs(arena), args(arena) {}
 };
 
-extern std::unordered_map<std::string, FunctionNode> function_nodes;
+// Counting memory resource
+// Passes allocations through to another resource, keeping track of how many were made
+class CountingResource : public std::pmr::memory_resource
+{
+	private:
+		std::pmr::memory_resource *upstream;
 
-// Reset
-void Reset();
+	public:
+		size_t allocations = 0;
+		size_t bytes = 0;
+		size_t current_bytes = 0;
+		size_t peak_bytes = 0;
+
+		explicit CountingResource(std::pmr::memory_resource *_upstream = std::pmr::new_delete_resource()) : upstream(_upstream) {}
+
+	protected:
+		void *do_allocate(size_t size, size_t alignment) override
+		{
+			void *p = upstream->allocate(size, alignment);
+
+			allocations++;
+			bytes += size;
+			current_bytes += size;
+			if (current_bytes > peak_bytes)
+				peak_bytes = current_bytes;
+
+			return p;
+		}
+
+		void do_deallocate(void *p, size_t size, size_t alignment) override
+		{
+			upstream->deallocate(p, size, alignment);
+			current_bytes -= size;
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			return this == &other;
+		}
+};
+
+// Parse context
+// Holds the registries of a single translation unit, so each source can be parsed independently.
+// Everything is allocated from the context's arena, which is released all at once when the context is destroyed.
+struct Context
+{
+	// Arena
+	// `arena` counts what the registries request, `arena_blocks` counts the blocks actually allocated for them
+	CountingResource arena_blocks;
+	std::pmr::monotonic_buffer_resource arena_buffer{&arena_blocks};
+	CountingResource arena{&arena_buffer};
+
+	// Types, indexed by their ID
+	std::pmr::vector<TypeNode> types{&arena};
+
+	// Type IDs by name, and by clang's uniqued type so that repeated uses of a type skip building its name
+	std::pmr::unordered_map<std::string_view, TypeId> type_ids{&arena};
+	std::pmr::unordered_map<const void *, TypeId> type_cache{&arena};
+
+	std::pmr::unordered_map<std::string_view, EnumNode> enum_nodes{&arena};
+	std::pmr::unordered_map<std::string_view, ClassNode> class_nodes{&arena};
+	std::pmr::unordered_map<std::string_view, FunctionNode> function_nodes{&arena};
+
+	// Qualified names of cursors, keyed by clang_hashCursor
+	std::pmr::unordered_multimap<unsigned int, std::pair<CXCursor, std::string_view>> cursor_names{&arena};
+
+	// Names of template specializations with their arguments, keyed the same way
+	std::pmr::unordered_multimap<unsigned int, std::pair<CXCursor, std::string_view>> specialization_names{&arena};
+
+	// Number of cursors visited while registering declarations
+	size_t cursor_visits = 0;
+
+	// Register types that can't be resolved as opaque instead of failing, for single file parses
+	bool lenient = false;
+
+	Context() = default;
+	Context(const Context &) = delete;
+	Context &operator=(const Context &) = delete;
+
+	// Copy a string into the arena
+	// Interned strings are null terminated, so data() can be passed on as a C string
+	std::string_view Intern(std::string_view str);
+};
+
+// Parse the string an annotate attribute carries, like "@leonkv \"key\" \"value\""
+LeonAttr ParseAttribute(Context &context, const std::string &src);
 
 // Clang cursor visitor
+// clientData is the Context to register declarations into
 CXChildVisitResult Visitor(CXCursor cursor, CXCursor parent, CXClientData clientData);
 
+// Visit a translation unit, registering each declaration into the context of the file it was declared in
+// The selector returns nullptr for files whose declarations should be skipped
+typedef std::function<Context *(CXFile file)> ContextSelector;
+
+void VisitTranslationUnit(CXTranslationUnit tu, const ContextSelector &select);
+
+// Check the diagnostics of a translation unit, throwing on an error
+// Diagnostics are written to the given stream so that parallel parses can be reported in order
+// A lenient check ignores errors, as a single file parse can't resolve anything from its includes
+void CheckTranslationUnit(CXTranslationUnit tu, CXErrorCode ec, std::ostream &diagnostics, bool lenient = false);
+
+// Indexer declaration callback
+// Registers declarations of the main file that aren't nested in another declaration, members are reached through their class
+void IndexDeclaration(Context &context, const CXIdxDeclInfo *info);
+
 }
 }
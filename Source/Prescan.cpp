@@ -0,0 +1,256 @@
+/*
+ * [ Leon ]
+ *   Source/Prescan.cpp
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Prescan.h"
+
+#include <cstring>
+#include <string_view>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Leon
+{
+namespace Prescan
+{
+
+// Read-only memory mapped file
+class MappedFile
+{
+	private:
+		const char *data = nullptr;
+		size_t size = 0;
+		bool valid = false;
+
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#endif
+
+	public:
+		MappedFile(const std::filesystem::path &path)
+		{
+#ifdef _WIN32
+			file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+
+			LARGE_INTEGER file_size;
+			if (!GetFileSizeEx(file, &file_size))
+				return;
+			size = static_cast<size_t>(file_size.QuadPart);
+
+			valid = true;
+			if (size == 0)
+				return;
+
+			mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping == nullptr)
+			{
+				valid = false;
+				return;
+			}
+
+			data = reinterpret_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (data == nullptr)
+				valid = false;
+#else
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				return;
+
+			struct stat st;
+			if (fstat(fd, &st) == 0)
+			{
+				size = static_cast<size_t>(st.st_size);
+				valid = true;
+
+				if (size != 0)
+				{
+					void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+					if (map == MAP_FAILED)
+						valid = false;
+					else
+						data = reinterpret_cast<const char *>(map);
+				}
+			}
+
+			close(fd);
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifdef _WIN32
+			if (data != nullptr)
+				UnmapViewOfFile(data);
+			if (mapping != nullptr)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+#else
+			if (data != nullptr)
+				munmap(const_cast<char *>(data), size);
+#endif
+		}
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		bool IsValid() const { return valid; }
+		std::string_view View() const { return data != nullptr ? std::string_view(data, size) : std::string_view(); }
+};
+
+// Character classes
+static bool IsIdentStart(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (static_cast<unsigned char>(c) >= 0x80);
+}
+
+static bool IsIdent(char c)
+{
+	return IsIdentStart(c) || (c >= '0' && c <= '9');
+}
+
+// Scan source text
+static Result ScanAnnotations(std::string_view src)
+{
+	Result result;
+
+	size_t i = 0;
+	size_t n = src.size();
+
+	// Skip a quoted literal, starting after the opening quote
+	auto skip_quoted = [&](char quote) -> void
+		{
+			while (i < n)
+			{
+				char c = src[i++];
+				if (c == '\\')
+					i++;
+				else if (c == quote || c == '\n')
+					break;
+			}
+		};
+
+	while (i < n)
+	{
+		char c = src[i];
+
+		if (c == '/' && i + 1 < n && src[i + 1] == '/')
+		{
+			// Line comment, which a trailing backslash continues
+			i += 2;
+			while (i < n && src[i] != '\n')
+			{
+				if (src[i] == '\\' && i + 1 < n && (src[i + 1] == '\n' || src[i + 1] == '\r'))
+					i++;
+				i++;
+			}
+		}
+		else if (c == '/' && i + 1 < n && src[i + 1] == '*')
+		{
+			// Block comment
+			size_t end = src.find("*/", i + 2);
+			i = (end == std::string_view::npos) ? n : (end + 2);
+		}
+		else if (c == '"' || c == '\'')
+		{
+			i++;
+			skip_quoted(c);
+		}
+		else if (c >= '0' && c <= '9')
+		{
+			// Numbers may contain ' digit separators and exponent signs
+			i++;
+			while (i < n)
+			{
+				char d = src[i];
+				if ((d == '+' || d == '-') && (src[i - 1] == 'e' || src[i - 1] == 'E' || src[i - 1] == 'p' || src[i - 1] == 'P'))
+					i++;
+				else if (IsIdent(d) || d == '.' || d == '\'')
+					i++;
+				else
+					break;
+			}
+		}
+		else if (IsIdentStart(c))
+		{
+			size_t start = i;
+			while (i < n && IsIdent(src[i]))
+				i++;
+			std::string_view ident = src.substr(start, i - start);
+
+			if (ident == "LEON" || ident == "LEON_KV" || ident == "LEON_V" || ident == "annotate")
+			{
+				result.annotations = true;
+				return result;
+			}
+			if (ident == "LEON_SINGLE_FILE")
+				result.single_file = true;
+
+			// Raw string literals, R"delim( ... )delim"
+			if (i < n && src[i] == '"' && ident.back() == 'R' && (ident == "R" || ident == "LR" || ident == "uR" || ident == "UR" || ident == "u8R"))
+			{
+				size_t open = src.find('(', i + 1);
+				if (open == std::string_view::npos)
+					return result;
+
+				std::string close = ")" + std::string(src.substr(i + 1, open - i - 1)) + "\"";
+				size_t end = src.find(close, open + 1);
+				i = (end == std::string_view::npos) ? n : (end + close.size());
+			}
+			else if (i < n && (src[i] == '"' || src[i] == '\''))
+			{
+				// Prefixed literals, like u8"" or L''
+				char quote = src[i++];
+				skip_quoted(quote);
+			}
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	return result;
+}
+
+Result Scan(const std::filesystem::path &path)
+{
+	MappedFile file(path);
+	if (!file.IsValid())
+		return { true, false };
+
+	return ScanAnnotations(file.View());
+}
+
+}
+}
@@ -0,0 +1,48 @@
+/*
+ * [ Leon ]
+ *   Source/Prescan.h
+ * Author(s): Regan Green
+ * Date: 2026-10-16
+ *
+ * Copyright (C) 2024 Regan "CKDEV" Green
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <filesystem>
+
+namespace Leon
+{
+namespace Prescan
+{
+
+// Prescan result
+struct Result
+{
+	bool annotations = false;
+	bool single_file = false;
+};
+
+// Scan a source for how it uses Leon
+// This scans the source's tokens for LEON, LEON_KV, LEON_V, or a raw `annotate` attribute, skipping comments and literals.
+// A source without any can't contain reflected declarations, so it doesn't need to be parsed.
+// Annotations hidden behind other macros aren't seen, use -no_prescan for sources that do that.
+// The scan stops at the first annotation, so LEON_SINGLE_FILE is only seen before it, at the top of the source.
+// Reports annotations if the source couldn't be read, so that it's parsed and the error reported normally.
+Result Scan(const std::filesystem::path &path);
+
+}
+}
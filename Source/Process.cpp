@@ -33,37 +33,46 @@ namespace Process
 {
 
 // Lua tables
-static void ConstructLuaAttributes(lua_State *T, const std::vector<Leon::Parse::LeonAttr> &attrs)
+static void ConstructLuaAttributes(lua_State *T, const std::pmr::vector<Leon::Parse::LeonAttr> &attrs)
 {
 	lua_newtable(T);
 	for (auto &i : attrs)
 	{
 		if (i.type == Leon::Parse::LeonAttr::Type::KeyValue)
 		{
-			lua_pushstring(T, i.kv.first.c_str());
-			lua_pushstring(T, i.kv.second.c_str());
+			lua_pushstring(T, i.kv.first.data());
+			lua_pushstring(T, i.kv.second.data());
 			lua_settable(T, -3);
 		}
 	}
 }
 
-void ConstructLuaTables(lua_State *T)
+void ConstructLuaTables(lua_State *T, const Leon::Parse::Context &context)
 {
-	// Create types table
+	// Create types table, and the table of the same types indexed by ID
+	// IDs are offset by one in Lua to start at 1, like its arrays
 	lua_newtable(T);
-	for (auto &i : Leon::Parse::type_nodes)
+	int types_idx = lua_gettop(T);
+
+	lua_newtable(T);
+	int type_ids_idx = lua_gettop(T);
+
+	for (auto &i : context.types)
 	{
-		lua_pushstring(T, i.first.c_str());
 		lua_newtable(T);
-		lua_settable(T, -3);
+
+		lua_pushstring(T, i.name.data());
+		lua_pushvalue(T, -2);
+		lua_settable(T, types_idx);
+
+		lua_rawseti(T, type_ids_idx, i.id + 1);
 	}
 
-	for (auto &i : Leon::Parse::type_nodes)
+	for (auto &i : context.types)
 	{
-		lua_pushstring(T, i.first.c_str());
-		lua_gettable(T, -2);
+		lua_rawgeti(T, type_ids_idx, i.id + 1);
 
-		switch (i.second.type)
+		switch (i.type)
 		{
 			case Leon::Parse::TypeNode::Type::Invalid:
 				throw std::runtime_error("Invalid type node");
@@ -90,25 +99,28 @@ void ConstructLuaTables(lua_State *T)
 				break;
 		}
 
-		LuaTableSetBoolean(T, -1, "const", i.second.q_const);
-		LuaTableSetBoolean(T, -1, "volatile", i.second.q_volatile);
-		LuaTableSetBoolean(T, -1, "restrict", i.second.q_restrict);
+		LuaTableSetBoolean(T, -1, "const", i.q_const);
+		LuaTableSetBoolean(T, -1, "volatile", i.q_volatile);
+		LuaTableSetBoolean(T, -1, "restrict", i.q_restrict);
 
-		LuaTableSetString(T, -1, "name", i.second.name.c_str());
-		LuaTableSetFromByString(T, -1, "root", -2, i.second.root.c_str());
-		LuaTableSetFromByString(T, -1, "unqualified_root", -2, i.second.unqualified_root.c_str());
-		LuaTableSetFromByString(T, -1, "unqualified", -2, i.second.unqualified.c_str());
-		LuaTableSetFromByString(T, -1, "pointee", -2, i.second.pointee.c_str());
+		LuaTableSetNumber(T, -1, "id", i.id + 1);
+		LuaTableSetString(T, -1, "name", i.name.data());
+		LuaTableSetFromIndex(T, -1, "root", type_ids_idx, i.root + 1);
+		LuaTableSetFromIndex(T, -1, "unqualified_root", type_ids_idx, i.unqualified_root + 1);
+		LuaTableSetFromIndex(T, -1, "unqualified", type_ids_idx, i.unqualified + 1);
+		if (i.pointee != Leon::Parse::InvalidTypeId)
+			LuaTableSetFromIndex(T, -1, "pointee", type_ids_idx, i.pointee + 1);
 
-		LuaTableSetBoolean(T, -1, "is_template", i.second.is_template);
+		LuaTableSetBoolean(T, -1, "is_template", i.is_template);
+		LuaTableSetBoolean(T, -1, "opaque", i.opaque);
 
-		if (i.second.is_template)
+		if (i.is_template)
 		{
 			lua_pushstring(T, "template_arguments");
 			lua_newtable(T);
 
 			int template_i = 1;
-			for (auto &t : i.second.template_args)
+			for (auto &t : i.template_args)
 			{
 				lua_pushnumber(T, template_i++);
 				lua_newtable(T);
@@ -119,7 +131,7 @@ void ConstructLuaTables(lua_State *T)
 						throw std::runtime_error("Invalid type node");
 					case Leon::Parse::TypeNode::TemplateArg::TemplateArgType::Type:
 						LuaTableSetString(T, -1, "argument_type", "type");
-						LuaTableSetFromByString(T, -1, "type", -6, t.type.c_str());
+						LuaTableSetFromIndex(T, -1, "type", type_ids_idx, t.type + 1);
 						break;
 					case Leon::Parse::TypeNode::TemplateArg::TemplateArgType::Nullptr:
 						LuaTableSetString(T, -1, "argument_type", "nullptr");
@@ -142,12 +154,12 @@ void ConstructLuaTables(lua_State *T)
 	// Create enums table
 	lua_newtable(T);
 
-	for (auto &i : Leon::Parse::enum_nodes)
+	for (auto &i : context.enum_nodes)
 	{
-		lua_pushstring(T, i.first.c_str());
+		lua_pushstring(T, i.first.data());
 		lua_newtable(T);
 
-		LuaTableSetString(T, -1, "name", i.second.name.c_str());
+		LuaTableSetString(T, -1, "name", i.second.name.data());
 
 		lua_pushstring(T, "attributes");
 		ConstructLuaAttributes(T, i.second.attrs);
@@ -157,7 +169,7 @@ void ConstructLuaTables(lua_State *T)
 		lua_newtable(T);
 		for (auto &v : i.second.elems)
 		{
-			lua_pushstring(T, v.first.c_str());
+			lua_pushstring(T, v.first.data());
 			lua_pushstring(T, std::to_string(v.second).c_str());
 			lua_settable(T, -3);
 		}
@@ -169,19 +181,19 @@ void ConstructLuaTables(lua_State *T)
 
 	// Create classes table
 	lua_newtable(T);
-	for (auto &i : Leon::Parse::class_nodes)
+	for (auto &i : context.class_nodes)
 	{
-		lua_pushstring(T, i.first.c_str());
+		lua_pushstring(T, i.first.data());
 		lua_newtable(T);
 		lua_settable(T, -3);
 	}
 
-	for (auto &i : Leon::Parse::class_nodes)
+	for (auto &i : context.class_nodes)
 	{
-		lua_pushstring(T, i.first.c_str());
+		lua_pushstring(T, i.first.data());
 		lua_gettable(T, -2);
 
-		LuaTableSetString(T, -1, "name", i.second.name.c_str());
+		LuaTableSetString(T, -1, "name", i.second.name.data());
 
 		switch (i.second.class_type)
 		{
@@ -201,14 +213,54 @@ void ConstructLuaTables(lua_State *T)
 
 		LuaTableSetBoolean(T, -1, "abstract", i.second.q_abstract);
 
+		LuaTableSetBoolean(T, -1, "is_template", i.second.is_template);
+		if (i.second.is_template)
+		{
+			lua_pushstring(T, "template_parameters");
+			lua_newtable(T);
+
+			int param_i = 1;
+			for (auto &v : i.second.template_params)
+			{
+				lua_pushnumber(T, param_i++);
+				lua_newtable(T);
+
+				LuaTableSetString(T, -1, "name", v.name.data());
+
+				switch (v.param_type)
+				{
+					case Leon::Parse::ClassNode::TemplateParam::ParamType::Invalid:
+						throw std::runtime_error("Invalid template parameter");
+					case Leon::Parse::ClassNode::TemplateParam::ParamType::Type:
+						LuaTableSetString(T, -1, "parameter_type", "type");
+						break;
+					case Leon::Parse::ClassNode::TemplateParam::ParamType::NonType:
+						LuaTableSetString(T, -1, "parameter_type", "non_type");
+						LuaTableSetFromIndex(T, -1, "type", type_ids_idx, v.type + 1);
+						break;
+					case Leon::Parse::ClassNode::TemplateParam::ParamType::Template:
+						LuaTableSetString(T, -1, "parameter_type", "template");
+						break;
+				}
+
+				lua_settable(T, -3);
+			}
+			lua_settable(T, -3);
+
+			// Filled with the specializations used in this source below
+			lua_pushstring(T, "instances");
+			lua_newtable(T);
+			lua_settable(T, -3);
+		}
+
 		lua_pushstring(T, "bases");
 		lua_newtable(T);
 		for (auto &v : i.second.bases)
 		{
-			lua_pushstring(T, v.base_class.c_str());
+			lua_pushstring(T, v.base_class.data());
 			lua_newtable(T);
 
-			LuaTableSetFromByString(T, -1, "class", -6, v.base_class.c_str());
+			LuaTableSetFromByString(T, -1, "class", -6, v.base_class.data());
 
 			switch (v.visibility)
 			{
@@ -233,10 +285,10 @@ void ConstructLuaTables(lua_State *T)
 		lua_newtable(T);
 		for (auto &v : i.second.members)
 		{
-			lua_pushstring(T, v.name.c_str());
+			lua_pushstring(T, v.name.data());
 			lua_newtable(T);
 
-			LuaTableSetString(T, -1, "name", v.name.c_str());
+			LuaTableSetString(T, -1, "name", v.name.data());
 
 			switch (v.member_type)
 			{
@@ -269,7 +321,7 @@ void ConstructLuaTables(lua_State *T)
 					break;
 			}
 
-			LuaTableSetFromByString(T, -1, "type", -8, v.type.c_str());
+			LuaTableSetFromIndex(T, -1, "type", type_ids_idx, v.type + 1);
 
 			lua_settable(T, -3);
 		}
@@ -279,10 +331,10 @@ void ConstructLuaTables(lua_State *T)
 		lua_newtable(T);
 		for (auto &v : i.second.methods)
 		{
-			lua_pushstring(T, v.name.c_str());
+			lua_pushstring(T, v.name.data());
 			lua_newtable(T);
 
-			LuaTableSetString(T, -1, "name", v.name.c_str());
+			LuaTableSetString(T, -1, "name", v.name.data());
 
 			switch (v.method_type)
 			{
@@ -322,7 +374,7 @@ void ConstructLuaTables(lua_State *T)
 			LuaTableSetBoolean(T, -1, "virtual", v.q_virtual);
 			LuaTableSetBoolean(T, -1, "pure", v.q_pure);
 
-			LuaTableSetFromByString(T, -1, "return_type", -8, v.return_type.c_str());
+			LuaTableSetFromIndex(T, -1, "return_type", type_ids_idx, v.return_type + 1);
 
 			lua_pushstring(T, "arguments");
 			lua_newtable(T);
@@ -332,9 +384,9 @@ void ConstructLuaTables(lua_State *T)
 				lua_pushnumber(T, arg_i++);
 				lua_newtable(T);
 
-				LuaTableSetFromByString(T, -1, "type", -12, a.type.c_str());
+				LuaTableSetFromIndex(T, -1, "type", type_ids_idx, a.type + 1);
 
-				LuaTableSetString(T, -1, "name", a.name.c_str());
+				LuaTableSetString(T, -1, "name", a.name.data());
 
 				lua_pushstring(T, "attributes");
 				ConstructLuaAttributes(T, a.attrs);
@@ -351,23 +403,52 @@ void ConstructLuaTables(lua_State *T)
 		lua_pop(T, 1);
 	}
 
+	// Link specializations to the templates they instantiate
+	// Only the unqualified specialization is an instance, its variants reach it through unqualified_root
+	for (auto &i : context.types)
+	{
+		if (i.template_name.empty())
+			continue;
+
+		lua_rawgeti(T, type_ids_idx, i.id + 1);
+		LuaTableSetFromByString(T, -1, "template", -2, i.template_name.data());
+
+		if (i.unqualified_root == i.id)
+		{
+			lua_pushstring(T, "template");
+			lua_gettable(T, -2);
+			if (lua_istable(T, -1))
+			{
+				lua_pushstring(T, "instances");
+				lua_gettable(T, -2);
+				if (lua_istable(T, -1))
+				{
+					lua_pushvalue(T, -3);
+					lua_rawseti(T, -2, lua_objlen(T, -2) + 1);
+				}
+				lua_pop(T, 1);
+			}
+			lua_pop(T, 1);
+		}
+
+		lua_pop(T, 1);
+	}
+
 	// Create functions table
 	lua_newtable(T);
 
-	for (auto &i : Leon::Parse::function_nodes)
+	for (auto &i : context.function_nodes)
 	{
-		lua_pushstring(T, i.first.c_str());
+		lua_pushstring(T, i.first.data());
 		lua_newtable(T);
 
-		LuaTableSetString(T, -1, "name", i.second.name.c_str());
+		LuaTableSetString(T, -1, "name", i.second.name.data());
 
 		lua_pushstring(T, "attributes");
 		ConstructLuaAttributes(T, i.second.attrs);
 		lua_settable(T, -3);
 
-		lua_pushstring(T, "return_type");
-		LuaTableGetString(T, -7, i.second.return_type.c_str());
-		lua_settable(T, -3);
+		LuaTableSetFromIndex(T, -1, "return_type", type_ids_idx, i.second.return_type + 1);
 
 		lua_pushstring(T, "arguments");
 		lua_newtable(T);
@@ -377,11 +458,9 @@ void ConstructLuaTables(lua_State *T)
 			lua_pushnumber(T, arg_i++);
 			lua_newtable(T);
 
-			lua_pushstring(T, "type");
-			LuaTableGetString(T, -11, a.type.c_str());
-			lua_settable(T, -3);
+			LuaTableSetFromIndex(T, -1, "type", type_ids_idx, a.type + 1);
 
-			LuaTableSetString(T, -1, "name", a.name.c_str());
+			LuaTableSetString(T, -1, "name", a.name.data());
 
 			lua_pushstring(T, "attributes");
 			ConstructLuaAttributes(T, a.attrs);
@@ -393,6 +472,166 @@ void ConstructLuaTables(lua_State *T)
 
 		lua_settable(T, -3);
 	}
+
+	// Move the type IDs table after the others
+	lua_pushvalue(T, type_ids_idx);
+	lua_remove(T, type_ids_idx);
+}
+
+// Get the error of a Lua thread
+static std::string GetThreadError(lua_State *T, int thread_status)
+{
+	std::string error;
+	if (thread_status == LUA_YIELD)
+		error = "thread yielded unexpectedly";
+	else if (const char *str = lua_tostring(T, -1))
+		error = str;
+
+	error += "\nstack backtrace:\n";
+	error += lua_debugtrace(T);
+
+	return error;
+}
+
+// Get the string result of a Lua call
+static std::string GetCallResult(lua_State *T, int thread_status)
+{
+	if (thread_status != 0)
+		throw std::runtime_error("Lua process failed to execute: " + GetThreadError(T, thread_status));
+
+	if (!lua_isstring(T, -1))
+		throw std::runtime_error("Lua process did not return `string`");
+	std::string output = lua_tostring(T, -1);
+	lua_pop(T, 1);
+
+	return output;
+}
+
+// Lua process script
+Script::Script(const std::string &source) : GL(luaL_newstate(), lua_close)
+{
+	luaL_openlibs(GL.get());
+
+	lua_State *L = lua_newthread(GL.get());
+
+	std::string bytecode = Luau::compile(source);
+	if (luau_load(L, "=in", bytecode.data(), bytecode.size(), 0) != 0)
+	{
+		size_t len;
+		const char *msg = lua_tolstring(L, -1, &len);
+
+		std::string error(msg, len);
+		lua_pop(L, 1);
+
+		throw std::runtime_error("Lua process failed to compile: " + error);
+	}
+
+	// Setup thread
+	// The stack now contains the function that will execute the loaded bytecode
+	T = lua_newthread(L);
+	lua_pushvalue(L, -2);
+	lua_remove(L, -3);
+	lua_xmove(L, T, 1);
+
+	int thread_status = lua_resume(T, nullptr, 0);
+
+	lua_pop(L, 1); // Remove thread off main stack
+
+	if (thread_status != LUA_OK)
+		throw std::runtime_error("Lua process failed to execute: " + GetThreadError(T, thread_status));
+
+	// Check for the table off the stack
+	if (lua_gettop(T) == 0 || !lua_istable(T, -1))
+		throw std::runtime_error("Lua process did not return `table`");
+}
+
+std::string Script::SourceProcess(const std::string &source, const Leon::Parse::Context &context)
+{
+	// Get SourceProcess function
+	lua_pushstring(T, "SourceProcess");
+	lua_gettable(T, -2);
+
+	// Run SourceProcess
+	lua_pushstring(T, source.c_str()); // source
+	ConstructLuaTables(T, context); // types, enums, classes, functions, type_ids
+
+	int thread_status = lua_pcall(T, 6, 1, 0);
+	return GetCallResult(T, thread_status);
+}
+
+std::string Script::GlueProcess(const std::vector<GlueSource> &sources, const Leon::Model::Model &model)
+{
+	// Get GlueProcess function
+	lua_pushstring(T, "GlueProcess");
+	lua_gettable(T, -2);
+
+	// Build sources table
+	lua_newtable(T);
+
+	int source_i = 1;
+	for (auto &source : sources)
+	{
+		lua_pushnumber(T, source_i++);
+		lua_newtable(T);
+
+		LuaTableSetString(T, -1, "source", source.source.c_str());
+		LuaTableSetString(T, -1, "out", source.out.c_str());
+
+		lua_settable(T, -3);
+	}
+
+	// Build declarations table
+	lua_newtable(T);
+
+	for (auto &i : model.declarations)
+	{
+		lua_pushstring(T, i.first.c_str());
+		lua_newtable(T);
+
+		LuaTableSetString(T, -1, "usr", i.first.c_str());
+		LuaTableSetString(T, -1, "name", i.second.name.c_str());
+
+		switch (i.second.kind)
+		{
+			case Leon::Model::Declaration::Kind::Invalid:
+				throw std::runtime_error("Invalid declaration");
+			case Leon::Model::Declaration::Kind::Struct:
+				LuaTableSetString(T, -1, "declaration_type", "struct");
+				break;
+			case Leon::Model::Declaration::Kind::Class:
+				LuaTableSetString(T, -1, "declaration_type", "class");
+				break;
+			case Leon::Model::Declaration::Kind::ClassTemplate:
+				LuaTableSetString(T, -1, "declaration_type", "template");
+				break;
+			case Leon::Model::Declaration::Kind::Enum:
+				LuaTableSetString(T, -1, "declaration_type", "enum");
+				break;
+			case Leon::Model::Declaration::Kind::Type:
+				LuaTableSetString(T, -1, "declaration_type", "type");
+				break;
+		}
+
+		LuaTableSetBoolean(T, -1, "abstract", i.second.q_abstract);
+		if (!i.second.source.empty())
+			LuaTableSetString(T, -1, "source", i.second.source.c_str());
+
+		lua_pushstring(T, "references");
+		lua_newtable(T);
+		int reference_i = 1;
+		for (auto &r : i.second.references)
+		{
+			lua_pushstring(T, r.c_str());
+			lua_rawseti(T, -2, reference_i++);
+		}
+		lua_settable(T, -3);
+
+		lua_settable(T, -3);
+	}
+
+	// Run GlueProcess
+	int thread_status = lua_pcall(T, 2, 1, 0);
+	return GetCallResult(T, thread_status);
 }
 
 }
@@ -26,7 +26,13 @@
 #include <lua.h>
 #include <lualib.h>
 
+#include "Parse.h"
+#include "Model.h"
+
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace Leon
 {
@@ -86,6 +92,21 @@ static void LuaTableSetString(lua_State *T, int idx, const char *name, const cha
 	lua_settable(T, idx - 2);
 }
 
+static void LuaTableSetNumber(lua_State *T, int idx, const char *name, double v)
+{
+	lua_pushstring(T, name);
+	lua_pushnumber(T, v);
+	lua_settable(T, idx - 2);
+}
+
+// idx_src must be an absolute stack index
+static void LuaTableSetFromIndex(lua_State *T, int idx_dst, const char *name_dst, int idx_src, int i)
+{
+	lua_pushstring(T, name_dst);
+	lua_rawgeti(T, idx_src, i);
+	lua_settable(T, idx_dst - 2);
+}
+
 static void LuaTableSetFromByString(lua_State *T, int idx_dst, const char *name_dst, int idx_src, const char *name_src)
 {
 	lua_pushstring(T, name_dst);
@@ -107,13 +128,40 @@ static void LuaTableGetString(lua_State *T, int idx, const char *name)
 
 // Lua process functions
 /*
-This pushes the following tables onto the stack
- - types
+This pushes the following tables onto the stack, built from the given parse context
+ - types, by name
  - enums
  - classes
  - functions
+ - type_ids, the same types indexed by their `id`
 */
-void ConstructLuaTables(lua_State *T);
+void ConstructLuaTables(lua_State *T, const Leon::Parse::Context &context);
+
+// Glue source
+struct GlueSource
+{
+	std::string source;
+	std::string out;
+};
+
+// Lua process script
+// Keeps the compiled script and its returned table alive so it can be run over many sources
+class Script
+{
+	private:
+		std::unique_ptr<lua_State, void (*)(lua_State *)> GL;
+		lua_State *T = nullptr;
+
+	public:
+		Script(const std::string &source);
+
+		// Run SourceProcess over a parsed source
+		std::string SourceProcess(const std::string &source, const Leon::Parse::Context &context);
+
+		// Run GlueProcess over every source
+		// Also passes the declarations of the whole target, by USR, so each is only seen once
+		std::string GlueProcess(const std::vector<GlueSource> &sources, const Leon::Model::Model &model);
+};
 
 }
 }
@@ -0,0 +1,15 @@
+# Run the checks of CheckTemplate.lua over the reflection of a source, from a clean binary directory
+# Include directories are separated by | as they can't be passed as a list
+string(REPLACE "|" ";" INCLUDES "${INCLUDES}")
+
+file(REMOVE_RECURSE "${BINARY_DIR}")
+
+execute_process(
+	COMMAND "${LEON_CLI}" "${BINARY_DIR}" "${LUA_PROCESS}" -out_extension .cpp -glue_extension .cpp -include "${INCLUDES}" "${SOURCE}"
+	RESULT_VARIABLE RESULT
+	OUTPUT_VARIABLE OUTPUT
+	ERROR_VARIABLE OUTPUT
+)
+if (NOT RESULT EQUAL 0)
+	message(FATAL_ERROR "The template checks failed:\n${OUTPUT}")
+endif()
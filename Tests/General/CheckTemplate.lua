@@ -0,0 +1,50 @@
+-- Checks the reflection of the Handle template and the Handle<int> member of CoolComponent, generating nothing
+local function check(condition, message)
+	if not condition then
+		error(message)
+	end
+end
+
+return {
+
+SourceProcess = function(source, types, enums, classes, functions)
+	if not string.find(source, "CoolComponent.h", 1, true) then
+		return ""
+	end
+
+	-- The annotated template is reflected once, with its parameters
+	local handle = classes["MyCoolGame::Handle"]
+	check(handle ~= nil, "Handle wasn't reflected")
+	check(handle.is_template, "Handle isn't a template")
+	check(#handle.template_parameters == 1, "Handle doesn't have one template parameter")
+	check(handle.template_parameters[1].name == "T", "Handle's template parameter isn't T")
+	check(handle.template_parameters[1].parameter_type == "type", "Handle's template parameter isn't a type")
+	check(handle.members["id"] ~= nil, "Handle's id wasn't reflected")
+
+	-- Its specialization is an instance pointing back at it
+	check(#handle.instances == 1, "Handle doesn't have one instance")
+	local instance = handle.instances[1]
+	check(instance.name == "MyCoolGame::Handle<int>", "Handle's instance isn't Handle<int>")
+	check(instance.is_template, "Handle<int> has no template arguments")
+	check(instance.template == handle, "Handle<int> doesn't point back at Handle")
+	check(#instance.template_arguments == 1, "Handle<int> doesn't have one template argument")
+	check(instance.template_arguments[1].argument_type == "type", "Handle<int>'s template argument isn't a type")
+	check(instance.template_arguments[1].type.name == "int", "Handle<int>'s template argument isn't int")
+
+	-- The member names the specialization
+	local cool = classes["MyCoolGame::Component::CoolComponent"]
+	check(cool ~= nil, "CoolComponent wasn't reflected")
+	check(cool.members["handle"] ~= nil, "CoolComponent's handle wasn't reflected")
+	check(cool.members["handle"].type.unqualified_root == instance, "CoolComponent's handle isn't a Handle<int>")
+
+	-- An unannotated template isn't reflected
+	check(classes["MyCoolGame::TemplateTest"] == nil, "TemplateTest was reflected")
+
+	return ""
+end;
+
+GlueProcess = function(sources)
+	return ""
+end;
+
+};
@@ -0,0 +1,53 @@
+# Export the model of a target from a clean binary directory, as one command and as separate source and glue commands
+# Once deleted, the export has to be written again by a run that finds everything else up to date
+# Include directories and sources are separated by | as they can't be passed as a list
+string(REPLACE "|" ";" INCLUDES "${INCLUDES}")
+string(REPLACE "|" ";" SOURCES "${SOURCES}")
+
+file(REMOVE_RECURSE "${BINARY_DIR}")
+
+function (run_leon DIR)
+	execute_process(
+		COMMAND "${LEON_CLI}" "${DIR}" "${LUA_PROCESS}" -out_extension .cpp -glue_extension .cpp ${ARGN} -include "${INCLUDES}" "${SOURCES}"
+		RESULT_VARIABLE RESULT
+		OUTPUT_VARIABLE OUTPUT
+		ERROR_VARIABLE OUTPUT
+	)
+	if (NOT RESULT EQUAL 0)
+		message(FATAL_ERROR "Leon.CLI ${ARGN} failed:\n${OUTPUT}")
+	endif()
+endfunction()
+
+function (check_export MODEL)
+	if (NOT EXISTS "${MODEL}")
+		message(FATAL_ERROR "${MODEL} wasn't exported")
+	endif()
+endfunction()
+
+# One command
+set(SINGLE_MODEL "${BINARY_DIR}/single/export.leonmodel")
+run_leon("${BINARY_DIR}/single" -export_model "${SINGLE_MODEL}")
+check_export("${SINGLE_MODEL}")
+
+file(REMOVE "${SINGLE_MODEL}")
+run_leon("${BINARY_DIR}/single" -export_model "${SINGLE_MODEL}")
+check_export("${SINGLE_MODEL}")
+
+# The sources, then the glue, like LEON_PER_SOURCE
+set(SPLIT_MODEL "${BINARY_DIR}/split/export.leonmodel")
+run_leon("${BINARY_DIR}/split" -no_glue)
+run_leon("${BINARY_DIR}/split" -glue_only -export_model "${SPLIT_MODEL}")
+check_export("${SPLIT_MODEL}")
+
+file(REMOVE "${SPLIT_MODEL}")
+run_leon("${BINARY_DIR}/split" -glue_only -export_model "${SPLIT_MODEL}")
+check_export("${SPLIT_MODEL}")
+
+# Both ways export the same model
+execute_process(
+	COMMAND "${CMAKE_COMMAND}" -E compare_files "${SINGLE_MODEL}" "${SPLIT_MODEL}"
+	RESULT_VARIABLE RESULT
+)
+if (NOT RESULT EQUAL 0)
+	message(FATAL_ERROR "The model exported by one command differs from the one exported by separate commands")
+endif()
@@ -0,0 +1,47 @@
+# Generate a source with and without the native frontend, and check the outputs are identical
+# Include directories and imported models are separated by | as they can't be passed as a list
+string(REPLACE "|" ";" INCLUDES "${INCLUDES}")
+string(REPLACE "|" ";" IMPORT_MODELS "${IMPORT_MODELS}")
+
+file(REMOVE_RECURSE "${BINARY_DIR}")
+
+foreach (FRONTEND native libclang)
+	set(OPTIONS -stats)
+	foreach (MODEL ${IMPORT_MODELS})
+		list(APPEND OPTIONS -import_model "${MODEL}")
+	endforeach()
+	if (FRONTEND STREQUAL "libclang")
+		list(APPEND OPTIONS -no_native)
+	endif()
+
+	execute_process(
+		COMMAND "${LEON_CLI}" "${BINARY_DIR}/${FRONTEND}" "${LUA_PROCESS}" -out_extension .cpp -glue_extension .cpp ${OPTIONS} -include "${INCLUDES}" "${SOURCE}"
+		RESULT_VARIABLE RESULT
+		OUTPUT_VARIABLE OUTPUT
+		ERROR_VARIABLE OUTPUT
+	)
+	if (NOT RESULT EQUAL 0)
+		message(FATAL_ERROR "Leon.CLI failed with the ${FRONTEND} frontend:\n${OUTPUT}")
+	endif()
+
+	# Make sure the native run didn't fall back to libclang
+	if (FRONTEND STREQUAL "native" AND NOT OUTPUT MATCHES "parsed without libclang")
+		message(FATAL_ERROR "${SOURCE} wasn't parsed by the native frontend:\n${OUTPUT}")
+	endif()
+endforeach()
+
+# The output directories mirror each other, only their root differs
+file(GLOB_RECURSE NATIVE_OUTPUTS RELATIVE "${BINARY_DIR}/native" "${BINARY_DIR}/native/*.cpp" "${BINARY_DIR}/native/*leon_model.txt")
+if (NOT NATIVE_OUTPUTS)
+	message(FATAL_ERROR "No outputs were generated")
+endif()
+
+foreach (OUTPUT ${NATIVE_OUTPUTS})
+	execute_process(
+		COMMAND "${CMAKE_COMMAND}" -E compare_files "${BINARY_DIR}/native/${OUTPUT}" "${BINARY_DIR}/libclang/${OUTPUT}"
+		RESULT_VARIABLE RESULT
+	)
+	if (NOT RESULT EQUAL 0)
+		message(FATAL_ERROR "${OUTPUT} differs between the native frontend and libclang")
+	endif()
+endforeach()
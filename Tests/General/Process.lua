@@ -18,9 +18,21 @@ local function dump(o, indent, recurse)
 	end
 
 	if type(o) == "table" then
+		-- Sort the keys, so that tables filled in a different order dump the same
+		local keys = {}
+		for k, _ in pairs(o) do
+			table.insert(keys, k)
+		end
+		table.sort(keys, function(a, b)
+			if type(a) ~= type(b) then
+				return type(a) < type(b)
+			end
+			return a < b
+		end)
+
 		local s = "{\n"
-		for k, v in pairs(o) do
-			s = s .. string.rep("    ", indent) .. "[" .. dump(k, indent + 1, recurse) .. "] = " .. dump(v, indent + 1, recurse) .. ",\n"
+		for _, k in ipairs(keys) do
+			s = s .. string.rep("    ", indent) .. "[" .. dump(k, indent + 1, recurse) .. "] = " .. dump(o[k], indent + 1, recurse) .. ",\n"
 		end
 		return s .. string.rep("    ", indent - 1) .. "}"
 	elseif type(o) == "string" then
@@ -18,6 +18,12 @@ struct LEON StupidClassToInheritFrom
 
 };
 
+template <typename T>
+struct LEON Handle
+{
+	int LEON id;
+};
+
 struct StupidUnknownClassToInheritFrom
 {
 
@@ -32,6 +38,9 @@ class LEON_KV("type", "cool") CoolComponent : public StupidClassToInheritFrom, p
 	{
 
 	}
+
+	// An instance of the reflected Handle template
+	Handle<int> LEON handle;
 };
 
 }
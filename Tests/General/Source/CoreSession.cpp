@@ -0,0 +1,79 @@
+#include <Leon/Core.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Lists the classes reflected from each source, and counts the sources in the glue
+static const char *process = R"(
+return {
+
+SourceProcess = function(source, types, enums, classes, functions)
+	local names = {}
+	for k, _ in pairs(classes) do
+		table.insert(names, k)
+	end
+	table.sort(names)
+	return table.concat(names, "\n")
+end;
+
+GlueProcess = function(sources)
+	return tostring(#sources)
+end;
+
+};
+)";
+
+static void Check(const std::string &output, const std::string &name)
+{
+	if (output.find(name) == std::string::npos)
+		throw std::runtime_error(name + " wasn't reflected, got:\n" + output);
+}
+
+// Parses headers through Leon.Core the way a tool keeping Leon loaded would
+// The first argument is the directory of the headers, the rest are include directories
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: CoreSession <source directory> [include directories...]" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		std::string source_dir = argv[1];
+
+		Leon::Core::ParseOptions options;
+		for (int i = 2; i < argc; i++)
+			options.includes.push_back(argv[i]);
+
+		// CoolComponent.h needs libclang, PlainComponent.h is parsed natively
+		Leon::Core::Session session;
+		Leon::Core::Reflection reflection = session.Parse({ source_dir + "/CoolComponent.h", source_dir + "/PlainComponent.h" }, options);
+
+		Leon::Core::Generator generator(process);
+		Leon::Core::Output output = generator.Run(reflection);
+
+		if (output.sources.size() != 2)
+			throw std::runtime_error("Expected an output per source");
+		Check(output.sources[0], "MyCoolGame::Component::CoolComponent");
+		Check(output.sources[0], "MyCoolGame::Handle");
+		Check(output.sources[1], "PlainComponent");
+
+		if (output.glue != "2")
+			throw std::runtime_error("Expected the glue to see both sources, got: " + output.glue);
+
+		// The same session parses again with its index kept loaded
+		Leon::Core::Reflection again = session.Parse({ source_dir + "/CoolComponent.h" }, options);
+		Check(generator.Run(again).sources.at(0), "MyCoolGame::Component::CoolComponent");
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
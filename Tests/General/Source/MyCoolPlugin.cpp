@@ -0,0 +1,9 @@
+#include "PluginComponent.h"
+#include "PluginHandle.h"
+
+extern void glue_register();
+
+void plugin_register()
+{
+	glue_register();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Leon/Leon.h>
+
+// Only plain structs and enums, so this header is parsed without libclang
+
+namespace MyCoolGame
+{
+
+namespace Plain
+{
+
+enum LEON_KV("enum", "Bikini") Bikini
+{
+	SpongeBob = 0,
+	Patrick = 1,
+	Plankton = 10,
+	Mario = Plankton + Patrick,
+	Luigi = Mario + 1000,
+	Kiryu,
+};
+
+enum class LEON_V("scoped") Krusty : unsigned char
+{
+	Krab,
+	Burger = 4,
+};
+
+struct LEON_KV("type", "plain") PlainComponent
+{
+	struct LEON Inner
+	{
+		unsigned LEON count;
+		const float LEON scale;
+	};
+
+	Inner LEON inner;
+
+	volatile int LEON ticks;
+	const volatile long long LEON stamp;
+	unsigned short LEON_KV("range", "0 100") health;
+
+	Bikini LEON bikini;
+	Krusty LEON krusty;
+
+	static const int LEON limit;
+};
+
+// Named like PlainComponent's nested struct, which hides this one in classes derived from PlainComponent
+struct LEON Inner
+{
+	int LEON outer;
+};
+
+struct LEON_KV("type", "derived") DerivedComponent : PlainComponent
+{
+	// PlainComponent::Inner, as a base's members are found before the namespace's
+	Inner LEON base_inner;
+	Krusty LEON derived_krusty;
+};
+
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Leon/Leon.h>
+
+#include "AppleComponent.h"
+#include "PlainComponent.h"
+
+// Derives from and names what MyCoolGame_Leon reflected, resolved from its model instead of its headers
+// Names from outside the namespace are qualified from the global scope, as the header could declare anything in the namespace itself
+
+namespace MyCoolPlugin
+{
+
+struct LEON_KV("type", "plugin") PluginComponent : public ::MyCoolGame::Plain::PlainComponent
+{
+	::MyCoolGame::Plain::Bikini LEON favourite;
+	::MyCoolGame::Plain::PlainComponent::Inner LEON extra;
+	int LEON level;
+};
+
+// The base is abstract, but like libclang only the class's own pure methods make it abstract
+class LEON PluginWeirdClass : public ::MyCoolGame::WeirdClass
+{
+	int LEON weirdness;
+};
+
+}
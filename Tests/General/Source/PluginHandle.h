@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Leon/Leon.h>
+
+#include "CoolComponent.h"
+
+// Naming a specialization of an imported class template needs libclang
+
+namespace MyCoolPlugin
+{
+
+struct LEON PluginHandle
+{
+	MyCoolGame::Handle<int> LEON handle;
+};
+
+}